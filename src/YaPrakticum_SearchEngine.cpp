@@ -13,8 +13,12 @@ using namespace std;
 #include "request_queue.h"
 #include "search_server.h"
 #include "unit_test.h"
+#include "load_generator.h"
 
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1 && argv[1] == "replay"s) {
+        return RunLoadGenerator(argc - 1, argv + 1);
+    }
     TestSearchServer();
     return 0;
 }
@@ -0,0 +1,27 @@
+/*
+ * async_search.cpp
+ *
+ */
+#include "async_search.h"
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer &search_server,
+        size_t thread_count) :
+        search_server_(search_server), pool_(thread_count) {
+}
+
+future<AsyncSearchResult> AsyncSearchServer::FindTopDocuments(
+        const string &raw_query, DocumentStatus status,
+        Clock::time_point deadline, CancellationToken token) {
+    return FindTopDocuments(raw_query,
+            [status](int, DocumentStatus document_status, int) {
+                return document_status == status;
+            }, deadline, token);
+}
+
+future<AsyncSearchResult> AsyncSearchServer::FindTopDocuments(
+        const string &raw_query, Clock::time_point deadline,
+        CancellationToken token) {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, deadline, token);
+}
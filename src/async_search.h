@@ -0,0 +1,85 @@
+#pragma once
+/*
+ * async_search.h
+ *
+ *  Асинхронный поиск поверх SearchServer. Запросы выполняются в пуле потоков,
+ *  каждый запрос ограничен сроком выполнения и может быть отменён.
+ *  SearchServer не должен изменяться, пока выполняются асинхронные запросы.
+ */
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+// Копии токена разделяют общий флаг отмены
+class CancellationToken {
+public:
+    CancellationToken() :
+            cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+    }
+
+    void Cancel() const {
+        cancelled_->store(true, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const {
+        return cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+struct AsyncSearchResult {
+    std::vector<Document> documents;
+    // true, если запрос прерван по сроку или отмене и результат частичный
+    bool truncated = false;
+};
+
+class AsyncSearchServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AsyncSearchServer(const SearchServer &search_server,
+            size_t thread_count = std::thread::hardware_concurrency());
+
+    template<typename Filter>
+    std::future<AsyncSearchResult> FindTopDocuments(
+            const std::string &raw_query, Filter filter_fun,
+            Clock::time_point deadline, CancellationToken token =
+                    CancellationToken());
+
+    std::future<AsyncSearchResult> FindTopDocuments(
+            const std::string &raw_query, DocumentStatus status,
+            Clock::time_point deadline, CancellationToken token =
+                    CancellationToken());
+
+    std::future<AsyncSearchResult> FindTopDocuments(
+            const std::string &raw_query, Clock::time_point deadline,
+            CancellationToken token = CancellationToken());
+
+private:
+    const SearchServer &search_server_;
+    ThreadPool pool_;
+};
+
+template<typename Filter>
+std::future<AsyncSearchResult> AsyncSearchServer::FindTopDocuments(
+        const std::string &raw_query, Filter filter_fun,
+        Clock::time_point deadline, CancellationToken token) {
+    return pool_.Submit(
+            [this, raw_query, filter_fun, deadline, token] {
+                AsyncSearchResult result;
+                auto should_stop = [&deadline, &token] {
+                    return token.IsCancelled() || Clock::now() >= deadline;
+                };
+                result.documents = search_server_.FindTopDocuments(raw_query,
+                        filter_fun, should_stop, result.truncated);
+                return result;
+            });
+}
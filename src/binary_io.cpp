@@ -0,0 +1,56 @@
+/*
+ * binary_io.cpp
+ *
+ */
+#include "binary_io.h"
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+array<uint32_t, 256> BuildCrc32Table() {
+    array<uint32_t, 256> table { };
+    for (uint32_t i = 0; i < table.size(); ++i) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+}
+
+uint32_t ComputeCrc32(string_view data) {
+    static const array<uint32_t, 256> table = BuildCrc32Table();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void RenameDurably(const string &from, const string &to) {
+    if (rename(from.c_str(), to.c_str()) != 0) {
+        throw runtime_error("Не удалось переименовать `"s + from + "`."s);
+    }
+    string directory = filesystem::path(to).parent_path().string();
+    if (directory.empty()) {
+        directory = "."s;
+    }
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw runtime_error("Не удалось открыть каталог `"s + directory + "`."s);
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    if (!synced) {
+        throw runtime_error("Ошибка fsync каталога `"s + directory + "`."s);
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+/*
+ * binary_io.h
+ *
+ *  Компактное двоичное кодирование для журнала и снимков индекса.
+ *  Целые числа записываются в формате varint (7 бит на байт, старший бит —
+ *  признак продолжения), знаковые — после zigzag-преобразования.
+ *  Чтение выбрасывает runtime_error, если данные закончились раньше времени.
+ */
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+inline void WriteVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void WriteSignedVarint(std::string &out, int64_t value) {
+    WriteVarint(out,
+            (static_cast<uint64_t>(value) << 1)
+                    ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline void WriteString(std::string &out, std::string_view str) {
+    WriteVarint(out, str.size());
+    out.append(str);
+}
+
+inline void WriteFixed32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+inline void WriteFixed64(std::string &out, uint64_t value) {
+    WriteFixed32(out, static_cast<uint32_t>(value));
+    WriteFixed32(out, static_cast<uint32_t>(value >> 32));
+}
+
+inline uint64_t ReadVarint(std::string_view &in) {
+    using std::operator""s;
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in.empty()) {
+            throw std::runtime_error("Неожиданный конец двоичных данных."s);
+        }
+        const uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Некорректное число в двоичных данных."s);
+}
+
+inline int64_t ReadSignedVarint(std::string_view &in) {
+    const uint64_t value = ReadVarint(in);
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline std::string_view ReadString(std::string_view &in) {
+    using std::operator""s;
+    const uint64_t size = ReadVarint(in);
+    if (size > in.size()) {
+        throw std::runtime_error("Неожиданный конец двоичных данных."s);
+    }
+    const std::string_view result = in.substr(0, size);
+    in.remove_prefix(size);
+    return result;
+}
+
+inline uint32_t ReadFixed32(std::string_view &in) {
+    using std::operator""s;
+    if (in.size() < 4) {
+        throw std::runtime_error("Неожиданный конец двоичных данных."s);
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (i * 8);
+    }
+    in.remove_prefix(4);
+    return value;
+}
+
+inline uint64_t ReadFixed64(std::string_view &in) {
+    const uint64_t low = ReadFixed32(in);
+    return low | static_cast<uint64_t>(ReadFixed32(in)) << 32;
+}
+
+// CRC-32 (полином 0xEDB88320) для проверки целостности записей
+uint32_t ComputeCrc32(std::string_view data);
+
+// Переименовывает from в to и выполняет fsync каталога, чтобы новое имя
+// сохранилось при сбое питания. Выбрасывает runtime_error при ошибке
+void RenameDurably(const std::string &from, const std::string &to);
@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * bounded_queue.h
+ *
+ *  Очередь фиксированной ёмкости для передачи данных между стадиями
+ *  конвейера. Push блокируется, пока очередь заполнена, Pop — пока она пуста.
+ *  После Close ожидающие потоки просыпаются, Push отклоняет новые элементы,
+ *  а Pop возвращает оставшиеся и затем false.
+ */
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) :
+            capacity_(capacity == 0 ? 1 : capacity) {
+    }
+
+    bool Push(T value) {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] {
+            return closed_ || items_.size() < capacity_;
+        });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool Pop(T &value) {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this] {
+            return closed_ || !items_.empty();
+        });
+        if (items_.empty()) {
+            return false;
+        }
+        value = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    const size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
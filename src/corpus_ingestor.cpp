@@ -0,0 +1,242 @@
+/*
+ * corpus_ingestor.cpp
+ *
+ */
+#include "corpus_ingestor.h"
+#include <charconv>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "bounded_queue.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace {
+
+double ToSeconds(chrono::nanoseconds time) {
+    return chrono::duration<double>(time).count();
+}
+
+string_view NextField(string_view &line) {
+    const size_t tab = line.find('\t');
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab == string_view::npos ? line.size() : tab + 1);
+    return field;
+}
+
+}
+
+double IngestionStageStats::GetDocumentsPerSecond() const {
+    const double seconds = ToSeconds(busy_time);
+    return seconds > 0 ? documents / seconds : 0.;
+}
+
+double IngestionStageStats::GetMegabytesPerSecond() const {
+    const double seconds = ToSeconds(busy_time);
+    return seconds > 0 ? bytes / seconds / (1 << 20) : 0.;
+}
+
+CorpusIngestor::CorpusIngestor(SearchServer &search_server,
+        IngestionOptions options) :
+        search_server_(search_server), options_(move(options)) {
+    if (options_.tokenizer_threads == 0) {
+        options_.tokenizer_threads = max(1u, thread::hardware_concurrency());
+    }
+    if (options_.chunk_size == 0) {
+        options_.chunk_size = 1;
+    }
+}
+
+IngestionStats CorpusIngestor::Ingest(const string &path) {
+    const auto start = chrono::steady_clock::now();
+    const MappedFile file(path);
+    const string_view data = file.GetData();
+
+    IngestionStats stats;
+    BoundedQueue<Chunk> chunks(options_.queue_capacity);
+    BoundedQueue<Batch> batches(options_.queue_capacity);
+
+    mutex stats_mutex;
+    exception_ptr error;
+    auto fail = [&](exception_ptr exception) {
+        {
+            lock_guard lock(stats_mutex);
+            if (!error) {
+                error = exception;
+            }
+        }
+        chunks.Close();
+        batches.Close();
+    };
+
+    // Стадия 1: разбиение на блоки по границам строк
+    thread splitter([&] {
+        const auto split_start = chrono::steady_clock::now();
+        size_t sequence = 0;
+        size_t offset = 0;
+        while (offset < data.size()) {
+            size_t end = min(data.size(), offset + options_.chunk_size);
+            const size_t line_end = data.find('\n', end - 1);
+            end = line_end == string_view::npos ? data.size() : line_end + 1;
+            if (!chunks.Push( { sequence++, data.substr(offset, end - offset) })) {
+                break;
+            }
+            offset = end;
+        }
+        chunks.Close();
+        lock_guard lock(stats_mutex);
+        stats.split.bytes = offset;
+        stats.split.busy_time = chrono::steady_clock::now() - split_start;
+    });
+
+    // Стадия 2: разбор строк и подсчёт слов
+    size_t active_tokenizers = options_.tokenizer_threads;
+    vector<thread> tokenizers;
+    for (size_t i = 0; i < options_.tokenizer_threads; ++i) {
+        tokenizers.emplace_back([&] {
+            IngestionStageStats local;
+            try {
+                Chunk chunk;
+                while (chunks.Pop(chunk)) {
+                    const auto chunk_start = chrono::steady_clock::now();
+                    Batch batch { chunk.sequence, chunk.data.size(), { } };
+                    string_view rest = chunk.data;
+                    while (!rest.empty()) {
+                        const size_t line_end = rest.find('\n');
+                        string_view line = rest.substr(0, line_end);
+                        rest.remove_prefix(
+                                line_end == string_view::npos ?
+                                        rest.size() : line_end + 1);
+                        if (!line.empty() && line.back() == '\r') {
+                            line.remove_suffix(1);
+                        }
+                        if (!line.empty()) {
+                            batch.documents.push_back(ParseLine(line));
+                        }
+                    }
+                    local.documents += batch.documents.size();
+                    local.bytes += batch.bytes;
+                    local.busy_time += chrono::steady_clock::now() - chunk_start;
+                    if (!batches.Push(move(batch))) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail(current_exception());
+            }
+            lock_guard lock(stats_mutex);
+            stats.tokenize.documents += local.documents;
+            stats.tokenize.bytes += local.bytes;
+            stats.tokenize.busy_time += local.busy_time;
+            if (--active_tokenizers == 0) {
+                batches.Close();
+            }
+        });
+    }
+
+    // Стадия 3: добавление в индекс в исходном порядке блоков
+    auto join_all = [&] {
+        splitter.join();
+        for (thread &tokenizer : tokenizers) {
+            tokenizer.join();
+        }
+    };
+    IngestionProgress progress;
+    progress.bytes_total = data.size();
+    map<size_t, Batch> reorder_buffer;
+    size_t next_sequence = 0;
+    try {
+        Batch batch;
+        while (batches.Pop(batch)) {
+            reorder_buffer.emplace(batch.sequence, move(batch));
+            for (auto it = reorder_buffer.begin();
+                    it != reorder_buffer.end() && it->first == next_sequence;
+                    it = reorder_buffer.erase(it), ++next_sequence) {
+                const auto index_start = chrono::steady_clock::now();
+                for (const TokenizedDocument &document : it->second.documents) {
+                    search_server_.AddDocument(document);
+                }
+                stats.index.busy_time += chrono::steady_clock::now()
+                        - index_start;
+                stats.index.documents += it->second.documents.size();
+                stats.index.bytes += it->second.bytes;
+
+                if (options_.on_progress) {
+                    progress.bytes_indexed = stats.index.bytes;
+                    progress.documents_indexed = stats.index.documents;
+                    progress.elapsed = chrono::steady_clock::now() - start;
+                    options_.on_progress(progress);
+                }
+            }
+        }
+    } catch (...) {
+        fail(current_exception());
+    }
+    join_all();
+    if (error) {
+        rethrow_exception(error);
+    }
+    stats.split.documents = stats.index.documents;
+    stats.elapsed = chrono::steady_clock::now() - start;
+    return stats;
+}
+
+TokenizedDocument CorpusIngestor::ParseLine(string_view line) const {
+    const string_view id_field = NextField(line);
+    const string_view status_field = NextField(line);
+    const string_view ratings_field = NextField(line);
+
+    int document_id = 0;
+    const auto [id_end, id_error] = from_chars(id_field.data(),
+            id_field.data() + id_field.size(), document_id);
+    if (id_error != errc() || id_end != id_field.data() + id_field.size()) {
+        throw invalid_argument(
+                "Некорректный идентификатор документа `"s + string(id_field)
+                        + "`."s);
+    }
+    return search_server_.TokenizeDocument(document_id, line,
+            ParseStatus(status_field), ParseRatings(ratings_field));
+}
+
+DocumentStatus CorpusIngestor::ParseStatus(string_view field) {
+    static const pair<string_view, DocumentStatus> statuses[] = { { "ACTUAL",
+            DocumentStatus::ACTUAL },
+            { "IRRELEVANT", DocumentStatus::IRRELEVANT }, { "BANNED",
+                    DocumentStatus::BANNED }, { "REMOVED",
+                    DocumentStatus::REMOVED } };
+    for (const auto& [name, status] : statuses) {
+        if (field == name) {
+            return status;
+        }
+    }
+    if (field.size() == 1 && field[0] >= '0' && field[0] <= '3') {
+        return static_cast<DocumentStatus>(field[0] - '0');
+    }
+    throw invalid_argument(
+            "Некорректный статус документа `"s + string(field) + "`."s);
+}
+
+vector<int> CorpusIngestor::ParseRatings(string_view field) {
+    vector<int> ratings;
+    const char *pos = field.data();
+    const char *end = field.data() + field.size();
+    while (pos != end) {
+        if (*pos == ' ') {
+            ++pos;
+            continue;
+        }
+        int rating = 0;
+        const auto [next, error] = from_chars(pos, end, rating);
+        if (error != errc()) {
+            throw invalid_argument(
+                    "Некорректный рейтинг документа `"s + string(field)
+                            + "`."s);
+        }
+        ratings.push_back(rating);
+        pos = next;
+    }
+    return ratings;
+}
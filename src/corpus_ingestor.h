@@ -0,0 +1,84 @@
+#pragma once
+/*
+ * corpus_ingestor.h
+ *
+ *  Загрузка корпуса документов из файла, отображённого в память.
+ *  Формат файла: по одному документу на строку, поля разделены табуляцией:
+ *      id <TAB> status <TAB> ratings <TAB> text
+ *  status — имя (ACTUAL, IRRELEVANT, BANNED, REMOVED) или его номер,
+ *  ratings — целые числа через пробел (поле может быть пустым).
+ *
+ *  Конвейер из трёх стадий, связанных очередями ограниченной ёмкости:
+ *  разбиение файла на блоки по границам строк, параллельный разбор строк
+ *  и подсчёт слов, добавление в индекс. Слова документов ссылаются
+ *  на отображённую память и копируются только при появлении нового слова
+ *  в словаре индекса. Документы добавляются в порядке следования в файле.
+ */
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+
+struct IngestionProgress {
+    size_t bytes_total = 0;
+    size_t bytes_indexed = 0;
+    size_t documents_indexed = 0;
+    std::chrono::nanoseconds elapsed { 0 };
+};
+
+struct IngestionStageStats {
+    size_t documents = 0;
+    size_t bytes = 0;
+    // Суммарное время работы всех потоков стадии
+    std::chrono::nanoseconds busy_time { 0 };
+
+    double GetDocumentsPerSecond() const;
+    double GetMegabytesPerSecond() const;
+};
+
+struct IngestionStats {
+    IngestionStageStats split;
+    IngestionStageStats tokenize;
+    IngestionStageStats index;
+    std::chrono::nanoseconds elapsed { 0 };
+};
+
+struct IngestionOptions {
+    size_t chunk_size = 1 << 20;
+    // 0 — по количеству аппаратных потоков
+    size_t tokenizer_threads = 0;
+    size_t queue_capacity = 8;
+    // Вызывается из потока Ingest после добавления каждого блока документов
+    std::function<void(const IngestionProgress&)> on_progress;
+};
+
+class CorpusIngestor {
+public:
+    explicit CorpusIngestor(SearchServer &search_server,
+            IngestionOptions options = IngestionOptions());
+
+    IngestionStats Ingest(const std::string &path);
+
+    // Разбор одной строки корпуса без изменения индекса
+    TokenizedDocument ParseLine(std::string_view line) const;
+
+private:
+    struct Chunk {
+        size_t sequence = 0;
+        std::string_view data;
+    };
+
+    struct Batch {
+        size_t sequence = 0;
+        size_t bytes = 0;
+        std::vector<TokenizedDocument> documents;
+    };
+
+    static DocumentStatus ParseStatus(std::string_view field);
+    static std::vector<int> ParseRatings(std::string_view field);
+
+    SearchServer &search_server_;
+    IngestionOptions options_;
+};
@@ -0,0 +1,131 @@
+/*
+ * document_reordering.cpp
+ *
+ */
+#include "document_reordering.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+const size_t MIN_PARTITION_SIZE = 16;
+const int MAX_DEPTH = 32;
+const int MAX_ITERATIONS = 20;
+
+// Оценка числа бит на запись списка слова, в котором degree документов
+// из size
+double GapCost(int degree, int size) {
+    return degree * log2(static_cast<double>(size) / (degree + 1));
+}
+
+class BisectionReorderer {
+public:
+    BisectionReorderer(const vector<vector<int>> &document_terms,
+            int term_count) :
+            document_terms_(document_terms), left_degree_(term_count, 0), right_degree_(
+                    term_count, 0) {
+    }
+
+    void Bisect(vector<int>::iterator begin, vector<int>::iterator end,
+            int depth) {
+        const size_t size = end - begin;
+        if (size <= MIN_PARTITION_SIZE || depth >= MAX_DEPTH) {
+            return;
+        }
+        const auto middle = begin + size / 2;
+        const int left_size = middle - begin;
+        const int right_size = end - middle;
+
+        for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+            CountDegrees(begin, middle, left_degree_);
+            CountDegrees(middle, end, right_degree_);
+
+            vector<pair<double, int>> left_gains;
+            for (auto it = begin; it != middle; ++it) {
+                left_gains.emplace_back(
+                        MoveGain(*it, left_degree_, left_size, right_degree_,
+                                right_size), *it);
+            }
+            vector<pair<double, int>> right_gains;
+            for (auto it = middle; it != end; ++it) {
+                right_gains.emplace_back(
+                        MoveGain(*it, right_degree_, right_size, left_degree_,
+                                left_size), *it);
+            }
+            ClearDegrees(begin, end);
+
+            sort(left_gains.begin(), left_gains.end(), greater<>());
+            sort(right_gains.begin(), right_gains.end(), greater<>());
+            size_t swaps = 0;
+            while (swaps < left_gains.size() && swaps < right_gains.size()
+                    && left_gains[swaps].first + right_gains[swaps].first > 0) {
+                swap(left_gains[swaps].second, right_gains[swaps].second);
+                ++swaps;
+            }
+            if (swaps == 0) {
+                break;
+            }
+            auto out = begin;
+            for (const auto &gain : left_gains) {
+                *out++ = gain.second;
+            }
+            for (const auto &gain : right_gains) {
+                *out++ = gain.second;
+            }
+        }
+        Bisect(begin, middle, depth + 1);
+        Bisect(middle, end, depth + 1);
+    }
+
+private:
+    void CountDegrees(vector<int>::iterator begin, vector<int>::iterator end,
+            vector<int> &degree) {
+        for (auto it = begin; it != end; ++it) {
+            for (const int term : document_terms_[*it]) {
+                ++degree[term];
+            }
+        }
+    }
+
+    void ClearDegrees(vector<int>::iterator begin, vector<int>::iterator end) {
+        for (auto it = begin; it != end; ++it) {
+            for (const int term : document_terms_[*it]) {
+                left_degree_[term] = 0;
+                right_degree_[term] = 0;
+            }
+        }
+    }
+
+    // Уменьшение стоимости при переносе документа из своей половины в другую
+    double MoveGain(int document, const vector<int> &from_degree, int from_size,
+            const vector<int> &to_degree, int to_size) const {
+        double gain = 0.;
+        for (const int term : document_terms_[document]) {
+            const int from = from_degree[term];
+            const int to = to_degree[term];
+            gain += GapCost(from, from_size) + GapCost(to, to_size)
+                    - GapCost(from - 1, from_size) - GapCost(to + 1, to_size);
+        }
+        return gain;
+    }
+
+    const vector<vector<int>> &document_terms_;
+    vector<int> left_degree_;
+    vector<int> right_degree_;
+};
+
+}
+
+vector<int> ComputeBisectionOrder(const vector<vector<int>> &document_terms,
+        int term_count) {
+    vector<int> order(document_terms.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    BisectionReorderer(document_terms, term_count).Bisect(order.begin(),
+            order.end(), 0);
+    return order;
+}
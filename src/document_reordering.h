@@ -0,0 +1,16 @@
+#pragma once
+/*
+ * document_reordering.h
+ *
+ *  Перенумерация документов рекурсивным разбиением двудольного графа
+ *  документ-слово (алгоритм BP, Dhulipala et al., 2016). Множество
+ *  документов делится пополам, затем документы обмениваются между
+ *  половинами, пока это уменьшает оценку стоимости разностного кодирования
+ *  списков документов, после чего половины разбиваются рекурсивно.
+ */
+#include <vector>
+
+// document_terms[d] — идентификаторы слов документа d, term_count — размер
+// словаря. Возвращает документы в новом порядке.
+std::vector<int> ComputeBisectionOrder(
+        const std::vector<std::vector<int>> &document_terms, int term_count);
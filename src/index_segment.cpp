@@ -0,0 +1,199 @@
+/*
+ * index_segment.cpp
+ *
+ */
+#include "index_segment.h"
+#include <algorithm>
+#include <queue>
+
+using namespace std;
+
+namespace {
+
+bool ByDocument(const Posting &lhs, const Posting &rhs) {
+    return lhs.first < rhs.first;
+}
+
+}
+
+bool PostingRange::ContainsDocument(int document_id) const {
+    return Find(document_id) != nullptr;
+}
+
+const Posting* PostingRange::Find(int document_id) const {
+    const Posting *it = lower_bound(begin_, end_, Posting(document_id, 0.),
+            ByDocument);
+    return it != end_ && it->first == document_id ? it : nullptr;
+}
+
+IndexSegment::IndexSegment(const map<string, PostingList, less<>> &buffer,
+        size_t first_tier_size) {
+    size_t posting_count = 0;
+    for (const auto &[term, postings] : buffer) {
+        posting_count += postings.size();
+    }
+    offsets_.reserve(buffer.size() + 1);
+    postings_.reserve(posting_count);
+    vector<int> documents;
+    for (const auto &[term, postings] : buffer) {
+        AppendTerm(term, postings.data(), postings.data() + postings.size());
+        for (const Posting &posting : postings) {
+            documents.push_back(posting.first);
+        }
+    }
+    sort(documents.begin(), documents.end());
+    document_count_ = unique(documents.begin(), documents.end())
+            - documents.begin();
+    Finish(first_tier_size);
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Merge(
+        const vector<shared_ptr<const IndexSegment>> &segments,
+        size_t first_tier_size, const vector<int> *new_ids) {
+    shared_ptr<IndexSegment> result(new IndexSegment());
+
+    // Слова каждого сегмента в порядке возрастания
+    vector<vector<pair<string, int>>> terms(segments.size());
+    size_t posting_count = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        terms[i].reserve(segments[i]->GetTermCount());
+        segments[i]->ForEachTermWithPrefix("", [&](string_view term, int id) {
+            terms[i].emplace_back(term, id);
+        });
+        posting_count += segments[i]->postings_.size();
+        result->document_count_ += segments[i]->document_count_;
+    }
+    result->postings_.reserve(posting_count);
+
+    // Слияние упорядоченных списков слов через кучу (слово, сегмент)
+    using HeapItem = pair<string_view, size_t>;
+    priority_queue<HeapItem, vector<HeapItem>, greater<>> heap;
+    vector<size_t> positions(segments.size(), 0);
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (!terms[i].empty()) {
+            heap.emplace(terms[i][0].first, i);
+        }
+    }
+    PostingList merged;
+    while (!heap.empty()) {
+        const string term(heap.top().first);
+        merged.clear();
+        while (!heap.empty() && heap.top().first == term) {
+            const size_t i = heap.top().second;
+            heap.pop();
+            const PostingRange range = segments[i]->GetPostings(
+                    terms[i][positions[i]].second);
+            merged.insert(merged.end(), range.begin(), range.end());
+            if (++positions[i] < terms[i].size()) {
+                heap.emplace(terms[i][positions[i]].first, i);
+            }
+        }
+        if (new_ids != nullptr) {
+            for (Posting &posting : merged) {
+                posting.first = (*new_ids)[posting.first];
+            }
+        }
+        if (!is_sorted(merged.begin(), merged.end(), ByDocument)) {
+            sort(merged.begin(), merged.end(), ByDocument);
+        }
+        result->AppendTerm(term, merged.data(), merged.data() + merged.size());
+    }
+    result->Finish(first_tier_size);
+    return result;
+}
+
+int IndexSegment::FindTerm(string_view term) const {
+    return dictionary_.Find(term);
+}
+
+PostingRange IndexSegment::GetPostings(int term_id) const {
+    return PostingRange(postings_.data() + offsets_[term_id],
+            postings_.data() + offsets_[term_id + 1]);
+}
+
+PostingRange IndexSegment::GetFirstTier(int term_id) const {
+    if (tier_offsets_.empty()
+            || offsets_[term_id + 1] - offsets_[term_id] <= first_tier_size_) {
+        return GetPostings(term_id);
+    }
+    return PostingRange(tier_postings_.data() + tier_offsets_[term_id],
+            tier_postings_.data() + tier_offsets_[term_id + 1]);
+}
+
+double IndexSegment::GetRestMaxTf(int term_id) const {
+    return rest_max_tf_.empty() ? 0. : rest_max_tf_[term_id];
+}
+
+void IndexSegment::ForEachTermWithPrefix(string_view prefix,
+        const function<void(string_view, int)> &callback) const {
+    dictionary_.ForEachWithPrefix(prefix, callback);
+}
+
+int IndexSegment::GetDocumentCount() const {
+    return document_count_;
+}
+
+size_t IndexSegment::GetFirstTierSize() const {
+    return first_tier_size_;
+}
+
+int IndexSegment::GetTermCount() const {
+    return static_cast<int>(dictionary_.GetSize());
+}
+
+size_t IndexSegment::GetDictionaryMemoryUsage() const {
+    return dictionary_.GetMemoryUsage();
+}
+
+size_t IndexSegment::GetPostingsMemoryUsage() const {
+    return GetHeapSize(offsets_) + GetHeapSize(postings_)
+            + GetHeapSize(tier_offsets_) + GetHeapSize(tier_postings_)
+            + GetHeapSize(rest_max_tf_);
+}
+
+void IndexSegment::AppendTerm(string_view term, const Posting *begin,
+        const Posting *end) {
+    dictionary_.Insert(term);
+    offsets_.push_back(postings_.size());
+    postings_.insert(postings_.end(), begin, end);
+}
+
+void IndexSegment::Finish(size_t first_tier_size) {
+    offsets_.push_back(postings_.size());
+    offsets_.shrink_to_fit();
+    postings_.shrink_to_fit();
+    dictionary_.Compact();
+    first_tier_size_ = first_tier_size;
+    if (first_tier_size_ > 0) {
+        BuildFirstTier();
+    }
+}
+
+void IndexSegment::BuildFirstTier() {
+    const size_t term_count = offsets_.size() - 1;
+    tier_offsets_.reserve(term_count + 1);
+    rest_max_tf_.assign(term_count, 0.);
+    PostingList term_postings;
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        tier_offsets_.push_back(tier_postings_.size());
+        const PostingRange postings = GetPostings(term_id);
+        if (postings.size() <= first_tier_size_) {
+            continue;
+        }
+        term_postings.assign(postings.begin(), postings.end());
+        const auto tier_end = term_postings.begin() + first_tier_size_;
+        nth_element(term_postings.begin(), tier_end, term_postings.end(),
+                [](const Posting &lhs, const Posting &rhs) {
+                    return lhs.second > rhs.second;
+                });
+        rest_max_tf_[term_id] = max_element(tier_end, term_postings.end(),
+                [](const Posting &lhs, const Posting &rhs) {
+                    return lhs.second < rhs.second;
+                })->second;
+        sort(term_postings.begin(), tier_end, ByDocument);
+        tier_postings_.insert(tier_postings_.end(), term_postings.begin(),
+                tier_end);
+    }
+    tier_offsets_.push_back(tier_postings_.size());
+    tier_postings_.shrink_to_fit();
+}
@@ -0,0 +1,103 @@
+#pragma once
+/*
+ * index_segment.h
+ *
+ *  Неизменяемый сегмент инвертированного индекса. Словарь сегмента хранится
+ *  в TermDictionary, списки документов всех слов лежат подряд в одном
+ *  массиве, упорядоченные по слову, а внутри слова — по документу.
+ *
+ *  Для длинных списков сегмент дополнительно хранит первый уровень —
+ *  first_tier_size записей с наибольшей частотой слова, упорядоченных
+ *  по документу, — и наибольшую частоту среди остальных записей.
+ */
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "term_dictionary.h"
+
+// Пара (внутренний идентификатор документа, частота слова в документе)
+using Posting = std::pair<int, double>;
+using PostingList = std::vector<Posting>;
+
+class PostingRange {
+public:
+    PostingRange(const Posting *begin, const Posting *end) :
+            begin_(begin), end_(end) {
+    }
+    explicit PostingRange(const PostingList &postings) :
+            begin_(postings.data()), end_(postings.data() + postings.size()) {
+    }
+
+    const Posting* begin() const {
+        return begin_;
+    }
+    const Posting* end() const {
+        return end_;
+    }
+    size_t size() const {
+        return end_ - begin_;
+    }
+
+    bool ContainsDocument(int document_id) const;
+    // Запись документа или nullptr
+    const Posting* Find(int document_id) const;
+
+private:
+    const Posting *begin_;
+    const Posting *end_;
+};
+
+class IndexSegment {
+public:
+    // Слова буфера упорядочены, списки документов упорядочены по документу.
+    // При first_tier_size = 0 первый уровень не строится
+    IndexSegment(const std::map<std::string, PostingList, std::less<>> &buffer,
+            size_t first_tier_size);
+
+    // Слияние сегментов. Если задан new_ids, идентификаторы документов
+    // заменяются на new_ids[id].
+    static std::shared_ptr<const IndexSegment> Merge(
+            const std::vector<std::shared_ptr<const IndexSegment>> &segments,
+            size_t first_tier_size, const std::vector<int> *new_ids = nullptr);
+
+    // Идентификатор слова в сегменте или TermDictionary::NOT_FOUND
+    int FindTerm(std::string_view term) const;
+    PostingRange GetPostings(int term_id) const;
+    // Первый уровень списка; для короткого списка — весь список
+    PostingRange GetFirstTier(int term_id) const;
+    // Наибольшая частота слова вне первого уровня или 0
+    double GetRestMaxTf(int term_id) const;
+    void ForEachTermWithPrefix(std::string_view prefix,
+            const std::function<void(std::string_view, int)> &callback) const;
+
+    int GetDocumentCount() const;
+    size_t GetFirstTierSize() const;
+    int GetTermCount() const;
+    size_t GetDictionaryMemoryUsage() const;
+    size_t GetPostingsMemoryUsage() const;
+
+private:
+    IndexSegment() = default;
+
+    void AppendTerm(std::string_view term, const Posting *begin,
+            const Posting *end);
+    void Finish(size_t first_tier_size);
+    void BuildFirstTier();
+
+    TermDictionary dictionary_;
+    // Списки документов слова term_id: [offsets_[term_id], offsets_[term_id + 1])
+    std::vector<size_t> offsets_;
+    PostingList postings_;
+    int document_count_ = 0;
+
+    size_t first_tier_size_ = 0;
+    // Первый уровень слова term_id:
+    // [tier_offsets_[term_id], tier_offsets_[term_id + 1])
+    std::vector<size_t> tier_offsets_;
+    PostingList tier_postings_;
+    std::vector<double> rest_max_tf_;
+};
@@ -0,0 +1,168 @@
+/*
+ * index_snapshot.cpp
+ *
+ *  Формат снимка: MAGIC, версия, LSN, стоп-слова, слова индекса, документы
+ *  (слова документа — разности номеров слов по возрастанию), CRC-32 всего
+ *  предшествующего содержимого.
+ */
+#include "index_snapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binary_io.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace {
+
+const uint32_t SNAPSHOT_MAGIC = 0x504E5353;  // "SSNP"
+const uint64_t SNAPSHOT_VERSION = 1;
+
+void WriteFileDurably(const string &path, const string &data) {
+    const string temp_path = path + ".tmp"s;
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Не удалось создать снимок `"s + path + "`."s);
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd, data.data() + written,
+                data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += result;
+    }
+    const bool synced = written == data.size() && fsync(fd) == 0;
+    close(fd);
+    if (!synced) {
+        throw runtime_error("Не удалось записать снимок `"s + path + "`."s);
+    }
+    RenameDurably(temp_path, path);
+}
+
+}
+
+void SaveSnapshot(const SearchServer &server, const string &path,
+        uint64_t lsn) {
+    const IndexExport index = server.ExportIndex();
+    string data;
+    WriteFixed32(data, SNAPSHOT_MAGIC);
+    WriteVarint(data, SNAPSHOT_VERSION);
+    WriteFixed64(data, lsn);
+    WriteVarint(data, index.stop_words.size());
+    for (const string &word : index.stop_words) {
+        WriteString(data, word);
+    }
+    WriteVarint(data, index.terms.size());
+    for (const string &term : index.terms) {
+        WriteString(data, term);
+    }
+    WriteVarint(data, index.documents.size());
+    for (const StoredDocument &document : index.documents) {
+        WriteSignedVarint(data, document.id);
+        WriteVarint(data, static_cast<uint64_t>(document.status));
+        WriteSignedVarint(data, document.rating);
+        WriteVarint(data, document.word_count);
+        WriteVarint(data, document.word_counts.size());
+        int previous = 0;
+        for (const auto& [term_id, count] : document.word_counts) {
+            WriteVarint(data, term_id - previous);
+            WriteVarint(data, count);
+            previous = term_id;
+        }
+    }
+    WriteFixed32(data, ComputeCrc32(data));
+    WriteFileDurably(path, data);
+}
+
+uint64_t LoadSnapshot(SearchServer &server, const string &path) {
+    if (server.GetDocumentCount() != 0) {
+        throw invalid_argument("Снимок загружается только в пустой сервер."s);
+    }
+    MappedFile file(path);
+    string_view data = file.GetData();
+    if (data.size() < sizeof(uint32_t) * 2) {
+        throw runtime_error("Файл `"s + path + "` не является снимком."s);
+    }
+    string_view checksum = data.substr(data.size() - sizeof(uint32_t));
+    data.remove_suffix(sizeof(uint32_t));
+    if (ReadFixed32(checksum) != ComputeCrc32(data)
+            || ReadFixed32(data) != SNAPSHOT_MAGIC) {
+        throw runtime_error("Снимок `"s + path + "` повреждён."s);
+    }
+    if (ReadVarint(data) != SNAPSHOT_VERSION) {
+        throw runtime_error("Неподдерживаемая версия снимка `"s + path + "`."s);
+    }
+    const uint64_t lsn = ReadFixed64(data);
+
+    vector<string> stop_words(ReadVarint(data));
+    for (string &word : stop_words) {
+        word = ReadString(data);
+    }
+    if (stop_words != server.GetStopWords()) {
+        throw invalid_argument(
+                "Стоп-слова сервера не совпадают со стоп-словами снимка."s);
+    }
+    vector<string_view> terms(ReadVarint(data));
+    for (string_view &term : terms) {
+        term = ReadString(data);
+    }
+
+    TokenizedDocument document;
+    for (uint64_t i = ReadVarint(data); i > 0; --i) {
+        document.id = static_cast<int>(ReadSignedVarint(data));
+        document.status = static_cast<DocumentStatus>(ReadVarint(data));
+        // средний рейтинг одной оценки равен ей самой
+        document.ratings.assign(1, static_cast<int>(ReadSignedVarint(data)));
+        document.word_count = static_cast<int>(ReadVarint(data));
+        document.word_counts.resize(ReadVarint(data));
+        uint64_t term_id = 0;
+        for (auto& [word, count] : document.word_counts) {
+            term_id += ReadVarint(data);
+            if (term_id >= terms.size()) {
+                throw runtime_error("Снимок `"s + path + "` повреждён."s);
+            }
+            word = terms[term_id];
+            count = static_cast<int>(ReadVarint(data));
+        }
+        server.AddDocument(document);
+    }
+    return lsn;
+}
+
+uint64_t RecoverSearchServer(SearchServer &server, const string &snapshot_path,
+        const string &journal_path) {
+    uint64_t lsn = 0;
+    if (filesystem::exists(snapshot_path)) {
+        lsn = LoadSnapshot(server, snapshot_path);
+    }
+    const uint64_t journal_lsn = Journal::Replay(journal_path, lsn,
+            [&server](const TokenizedDocument &document) {
+                // запись, отклонённая сервером при добавлении, отклоняется
+                // и при восстановлении: состояние сервера то же
+                try {
+                    server.CheckDocument(document);
+                } catch (const invalid_argument&) {
+                    return;
+                }
+                server.AddDocument(document);
+            });
+    return max(lsn, journal_lsn);
+}
+
+void Checkpoint(const SearchServer &server, Journal &journal,
+        const string &snapshot_path) {
+    journal.Sync();
+    // SaveSnapshot возвращается, когда новое имя снимка уже на диске;
+    // иначе после сбоя мог бы сохраниться пустой журнал со старым снимком
+    SaveSnapshot(server, snapshot_path, journal.GetLastLsn());
+    journal.Reset();
+}
@@ -0,0 +1,34 @@
+#pragma once
+/*
+ * index_snapshot.h
+ *
+ *  Снимок индекса на диске и восстановление после сбоя. Снимок хранит
+ *  документы в разобранном виде и LSN последней записи журнала, которая
+ *  в него вошла. При восстановлении загружается снимок, а из журнала
+ *  применяются только записи с большим LSN, поэтому время восстановления
+ *  ограничено размером журнала.
+ */
+#include <cstdint>
+#include <string>
+#include "journal.h"
+#include "search_server.h"
+
+// Снимок записывается во временный файл и атомарно заменяет прежний;
+// к возврату замена сохранена на диске вместе с записью каталога
+void SaveSnapshot(const SearchServer &server, const std::string &path,
+        uint64_t lsn);
+
+// Добавляет документы снимка в пустой сервер с теми же стоп-словами
+// и возвращает LSN снимка
+uint64_t LoadSnapshot(SearchServer &server, const std::string &path);
+
+// Загружает снимок, если он есть, и применяет хвост журнала; записи,
+// которые сервер отклонил бы, пропускаются.
+// Возвращает LSN последнего восстановленного документа
+uint64_t RecoverSearchServer(SearchServer &server,
+        const std::string &snapshot_path, const std::string &journal_path);
+
+// Сохраняет снимок со всеми записями журнала и очищает журнал.
+// Документы не должны добавляться во время выполнения
+void Checkpoint(const SearchServer &server, Journal &journal,
+        const std::string &snapshot_path);
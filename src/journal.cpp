@@ -0,0 +1,320 @@
+/*
+ * journal.cpp
+ *
+ *  Формат файла: заголовок (MAGIC, LSN последней записи до начала файла),
+ *  затем записи: длина данных (4 байта), CRC-32 данных (4 байта), данные.
+ */
+#include "journal.h"
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binary_io.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace {
+
+const uint32_t JOURNAL_MAGIC = 0x4E524A53;  // "SJRN"
+const size_t HEADER_SIZE = 12;
+const size_t FRAME_HEADER_SIZE = 8;
+
+}
+
+Journal::Journal(const string &path, JournalOptions options) :
+        path_(path), options_(options) {
+    ReplayResult existing = ReadJournal(path_, 0, nullptr);
+    if (existing.valid_size == 0) {
+        CreateEmpty(0);
+        file_size_ = HEADER_SIZE;
+    } else {
+        // отрезаем недописанный при сбое хвост, чтобы новые записи шли
+        // сразу за последней целой
+        if (truncate(path_.c_str(), existing.valid_size) != 0) {
+            throw runtime_error("Не удалось обрезать журнал `"s + path_ + "`."s);
+        }
+        fd_ = open(path_.c_str(), O_WRONLY | O_APPEND);
+        if (fd_ < 0) {
+            throw runtime_error("Не удалось открыть журнал `"s + path_ + "`."s);
+        }
+        for (const string &term : existing.terms) {
+            terms_.Insert(term);
+        }
+        file_size_ = existing.valid_size;
+    }
+    last_lsn_ = existing.last_lsn;
+    committed_lsn_ = existing.last_lsn;
+    last_fsync_ = chrono::steady_clock::now();
+}
+
+Journal::~Journal() {
+    try {
+        Commit();
+        if (options_.fsync_policy != FsyncPolicy::NEVER && unsynced_) {
+            SyncFile();
+        }
+    } catch (const exception&) {
+        // деструктор не должен выбрасывать исключения; незафиксированные
+        // записи будут потеряны так же, как при сбое
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+uint64_t Journal::Append(const TokenizedDocument &document) {
+    uint64_t lsn;
+    bool commit;
+    {
+        lock_guard lock(buffer_mutex_);
+        CheckNotFailed();
+        lsn = ++last_lsn_;
+        string definitions;
+        size_t definition_count = 0;
+        string references;
+        for (const auto& [word, count] : document.word_counts) {
+            const size_t term_count = terms_.GetSize();
+            const int term_id = terms_.Insert(word);
+            if (static_cast<size_t>(term_id) == term_count) {
+                WriteString(definitions, word);
+                ++definition_count;
+            }
+            WriteVarint(references, term_id);
+            WriteVarint(references, count);
+        }
+
+        string payload;
+        payload.push_back(static_cast<char>(RecordType::ADD_DOCUMENT));
+        WriteVarint(payload, lsn);
+        WriteSignedVarint(payload, document.id);
+        WriteVarint(payload, static_cast<uint64_t>(document.status));
+        WriteVarint(payload, document.ratings.size());
+        for (const int rating : document.ratings) {
+            WriteSignedVarint(payload, rating);
+        }
+        WriteVarint(payload, document.word_count);
+        WriteVarint(payload, definition_count);
+        payload += definitions;
+        WriteVarint(payload, document.word_counts.size());
+        payload += references;
+
+        WriteFixed32(buffer_, payload.size());
+        WriteFixed32(buffer_, ComputeCrc32(payload));
+        buffer_ += payload;
+        commit = buffer_.size() >= options_.group_commit_bytes;
+    }
+    if (commit) {
+        Commit();
+    }
+    return lsn;
+}
+
+void Journal::Commit() {
+    lock_guard io_lock(io_mutex_);
+    CheckNotFailed();
+    string data;
+    uint64_t lsn;
+    {
+        lock_guard lock(buffer_mutex_);
+        data.swap(buffer_);
+        lsn = last_lsn_;
+    }
+    if (!data.empty()) {
+        try {
+            WriteBuffer(data);
+        } catch (const runtime_error&) {
+            // убираем недописанную запись, чтобы файл оканчивался целой;
+            // записи буфера потеряны, а словарь уже содержит их слова
+            failed_ = true;
+            if (ftruncate(fd_, file_size_) != 0) {
+                // хвост будет отрезан при следующем открытии
+            }
+            throw;
+        }
+        file_size_ += data.size();
+        unsynced_ = true;
+    }
+    if (unsynced_) {
+        if (options_.fsync_policy == FsyncPolicy::ON_COMMIT
+                || (options_.fsync_policy == FsyncPolicy::INTERVAL
+                        && chrono::steady_clock::now() - last_fsync_
+                                >= options_.fsync_interval)) {
+            SyncFile();
+        }
+    }
+    committed_lsn_ = lsn;
+}
+
+void Journal::Sync() {
+    Commit();
+    lock_guard io_lock(io_mutex_);
+    if (unsynced_) {
+        SyncFile();
+    }
+}
+
+uint64_t Journal::GetLastLsn() const {
+    lock_guard lock(buffer_mutex_);
+    return last_lsn_;
+}
+
+uint64_t Journal::GetCommittedLsn() const {
+    return committed_lsn_;
+}
+
+void Journal::Reset() {
+    lock_guard io_lock(io_mutex_);
+    lock_guard lock(buffer_mutex_);
+    CheckNotFailed();
+    buffer_.clear();
+    terms_ = TermDictionary();
+    CreateEmpty(last_lsn_);
+    file_size_ = HEADER_SIZE;
+    unsynced_ = false;
+    committed_lsn_ = last_lsn_;
+}
+
+uint64_t Journal::Replay(const string &path, uint64_t after_lsn,
+        const function<void(const TokenizedDocument&)> &callback) {
+    return ReadJournal(path, after_lsn, callback).last_lsn;
+}
+
+Journal::ReplayResult Journal::ReadJournal(const string &path,
+        uint64_t after_lsn,
+        const function<void(const TokenizedDocument&)> &callback) {
+    ReplayResult result;
+    if (!filesystem::exists(path)) {
+        return result;
+    }
+    MappedFile file(path);
+    string_view data = file.GetData();
+    if (data.size() < HEADER_SIZE) {
+        return result;
+    }
+    if (ReadFixed32(data) != JOURNAL_MAGIC) {
+        throw runtime_error("Файл `"s + path + "` не является журналом."s);
+    }
+    result.last_lsn = ReadFixed64(data);
+    result.valid_size = HEADER_SIZE;
+
+    TokenizedDocument document;
+    while (data.size() >= FRAME_HEADER_SIZE) {
+        string_view frame = data;
+        const uint32_t size = ReadFixed32(frame);
+        const uint32_t crc = ReadFixed32(frame);
+        if (size == 0 || size > frame.size()
+                || ComputeCrc32(frame.substr(0, size)) != crc) {
+            break;
+        }
+        string_view payload = frame.substr(0, size);
+        const size_t term_count = result.terms.size();
+        uint64_t lsn = 0;
+        if (!DecodeDocument(payload, result.terms, lsn, document)) {
+            // запись, которую нельзя разобрать, считается концом журнала
+            result.terms.resize(term_count);
+            break;
+        }
+        if (callback && lsn > after_lsn) {
+            callback(document);
+        }
+        result.last_lsn = lsn;
+        result.valid_size += FRAME_HEADER_SIZE + size;
+        data.remove_prefix(FRAME_HEADER_SIZE + size);
+    }
+    return result;
+}
+
+bool Journal::DecodeDocument(string_view payload, vector<string> &terms,
+        uint64_t &lsn, TokenizedDocument &document) {
+    const auto type = static_cast<RecordType>(payload.front());
+    payload.remove_prefix(1);
+    if (type != RecordType::ADD_DOCUMENT) {
+        return false;
+    }
+    try {
+        lsn = ReadVarint(payload);
+        document.id = static_cast<int>(ReadSignedVarint(payload));
+        document.status = static_cast<DocumentStatus>(ReadVarint(payload));
+        document.ratings.resize(ReadVarint(payload));
+        for (int &rating : document.ratings) {
+            rating = static_cast<int>(ReadSignedVarint(payload));
+        }
+        document.word_count = static_cast<int>(ReadVarint(payload));
+        for (uint64_t i = ReadVarint(payload); i > 0; --i) {
+            terms.emplace_back(ReadString(payload));
+        }
+        // ссылки на слова создаются после добавления новых слов,
+        // которые могут перераспределить память вектора
+        document.word_counts.resize(ReadVarint(payload));
+        for (auto& [word, count] : document.word_counts) {
+            const uint64_t term_id = ReadVarint(payload);
+            if (term_id >= terms.size()) {
+                // ссылка на слово, определение которого не дошло до файла
+                return false;
+            }
+            word = terms[term_id];
+            count = static_cast<int>(ReadVarint(payload));
+        }
+    } catch (const runtime_error&) {
+        // данные записи закончились раньше времени
+        return false;
+    }
+    return true;
+}
+
+void Journal::CreateEmpty(uint64_t base_lsn) {
+    string header;
+    WriteFixed32(header, JOURNAL_MAGIC);
+    WriteFixed64(header, base_lsn);
+    const string temp_path = path_ + ".tmp"s;
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Не удалось создать журнал `"s + path_ + "`."s);
+    }
+    const bool written = write(fd, header.data(), header.size())
+            == static_cast<ssize_t>(header.size()) && fsync(fd) == 0;
+    close(fd);
+    if (!written) {
+        throw runtime_error("Не удалось создать журнал `"s + path_ + "`."s);
+    }
+    RenameDurably(temp_path, path_);
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = open(path_.c_str(), O_WRONLY | O_APPEND);
+    if (fd_ < 0) {
+        throw runtime_error("Не удалось открыть журнал `"s + path_ + "`."s);
+    }
+}
+
+void Journal::CheckNotFailed() const {
+    if (failed_) {
+        throw runtime_error(
+                "Журнал `"s + path_ + "` недоступен после ошибки записи."s);
+    }
+}
+
+void Journal::WriteBuffer(const string &data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd_, data.data() + written,
+                data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("Ошибка записи в журнал `"s + path_ + "`."s);
+        }
+        written += result;
+    }
+}
+
+void Journal::SyncFile() {
+    if (fdatasync(fd_) != 0) {
+        throw runtime_error("Ошибка fsync журнала `"s + path_ + "`."s);
+    }
+    unsynced_ = false;
+    last_fsync_ = chrono::steady_clock::now();
+}
@@ -0,0 +1,132 @@
+#pragma once
+/*
+ * journal.h
+ *
+ *  Журнал упреждающей записи для добавления документов. Документ
+ *  записывается в журнал уже разобранным: слова заменяются идентификаторами
+ *  из словаря журнала, а новое слово определяется в первой использующей его
+ *  записи. Каждая запись имеет номер LSN и снабжена длиной и CRC-32, поэтому
+ *  недописанный при сбое хвост обнаруживается и отрезается при открытии.
+ *
+ *  Append только кодирует запись в буфер памяти; Commit записывает все
+ *  накопленные записи одним вызовом write и выполняет fsync согласно
+ *  политике. Потоки, вызвавшие Commit во время записи другого потока,
+ *  дожидаются её и сбрасывают всё накопленное за это время одной операцией
+ *  (групповая фиксация).
+ *
+ *  Порядок работы: server.TokenizeDocument -> server.CheckDocument ->
+ *  journal.Append -> server.AddDocument, без других добавлений между
+ *  проверкой и добавлением; так в журнал не попадают документы, которые
+ *  сервер отклонит. Восстановление выполняет RecoverSearchServer
+ *  из index_snapshot.h.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+#include "term_dictionary.h"
+
+enum class FsyncPolicy {
+    NEVER,      // данные остаются в кэше ОС до её решения
+    ON_COMMIT,  // fsync после каждой групповой фиксации
+    // fsync при очередном Commit, если с прошлого fsync прошло не меньше
+    // fsync_interval. Таймера нет: последняя зафиксированная группа
+    // остаётся без fsync до следующего Commit, поэтому при редких
+    // добавлениях вызывающий сам периодически вызывает Sync
+    INTERVAL
+};
+
+struct JournalOptions {
+    FsyncPolicy fsync_policy = FsyncPolicy::ON_COMMIT;
+    std::chrono::milliseconds fsync_interval { 100 };
+    // Размер буфера, при котором Append сам выполняет Commit
+    size_t group_commit_bytes = 1 << 16;
+};
+
+class Journal {
+public:
+    // Тип записи хранится в каждой записи, чтобы в журнал можно было
+    // добавить другие операции, например удаление документа
+    enum class RecordType : uint8_t {
+        ADD_DOCUMENT = 1
+    };
+
+    // Открывает или создаёт журнал; повреждённый хвост файла отрезается
+    explicit Journal(const std::string &path, JournalOptions options =
+            JournalOptions());
+    // Фиксирует накопленные записи
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Возвращает LSN записи
+    uint64_t Append(const TokenizedDocument &document);
+    // При ошибке записи файл обрезается до последней целой записи,
+    // а этот и все последующие вызовы Append и Commit выбрасывают
+    // runtime_error
+    void Commit();
+    // Выполняет Commit и fsync независимо от политики; при INTERVAL
+    // ограничивает время, в течение которого записи не защищены от сбоя
+    void Sync();
+
+    uint64_t GetLastLsn() const;
+    uint64_t GetCommittedLsn() const;
+
+    // Удаляет все записи; вызывается после сохранения снимка, который
+    // содержит документы до GetLastLsn() включительно
+    void Reset();
+
+    // Передаёт в callback документы с LSN больше after_lsn в порядке записи
+    // и возвращает LSN последней целой записи. Чтение останавливается
+    // на первой повреждённой, недописанной или нераспознанной записи.
+    static uint64_t Replay(const std::string &path, uint64_t after_lsn,
+            const std::function<void(const TokenizedDocument&)> &callback);
+
+private:
+    struct ReplayResult {
+        uint64_t last_lsn = 0;
+        // Размер начала файла, состоящего из целых записей
+        size_t valid_size = 0;
+        std::vector<std::string> terms;
+    };
+
+    static ReplayResult ReadJournal(const std::string &path,
+            uint64_t after_lsn,
+            const std::function<void(const TokenizedDocument&)> &callback);
+    // Разбирает данные записи; false, если запись нельзя разобрать
+    static bool DecodeDocument(std::string_view payload,
+            std::vector<std::string> &terms, uint64_t &lsn,
+            TokenizedDocument &document);
+    void CheckNotFailed() const;
+    // Атомарно заменяет файл журнала пустым, начинающимся после base_lsn
+    void CreateEmpty(uint64_t base_lsn);
+    void WriteBuffer(const std::string &data);
+    void SyncFile();
+
+    std::string path_;
+    JournalOptions options_;
+    int fd_ = -1;
+
+    // Защищает буфер, словарь и счётчик LSN
+    mutable std::mutex buffer_mutex_;
+    std::string buffer_;
+    TermDictionary terms_;
+    uint64_t last_lsn_ = 0;
+
+    // Удерживается на время записи в файл
+    std::mutex io_mutex_;
+    // Размер файла после последней успешной записи
+    size_t file_size_ = 0;
+    // После ошибки записи словарь журнала опережает файл, поэтому журнал
+    // перестаёт принимать записи; его нужно открыть заново
+    std::atomic<bool> failed_ { false };
+    std::atomic<uint64_t> committed_lsn_ { 0 };
+    bool unsynced_ = false;
+    std::chrono::steady_clock::time_point last_fsync_;
+};
@@ -0,0 +1,101 @@
+/*
+ * latency_histogram.cpp
+ *
+ */
+#include "latency_histogram.h"
+#include <cmath>
+
+using namespace std;
+
+void LatencyHistogram::Add(chrono::nanoseconds value) {
+    ++buckets_[GetBucketIndex(value.count() > 0 ? value.count() : 0)];
+    ++count_;
+}
+
+void LatencyHistogram::Remove(chrono::nanoseconds value) {
+    uint64_t &bucket = buckets_[GetBucketIndex(
+            value.count() > 0 ? value.count() : 0)];
+    if (bucket > 0) {
+        --bucket;
+        --count_;
+    }
+}
+
+void LatencyHistogram::Clear() {
+    buckets_.fill(0);
+    count_ = 0;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const {
+    if (count_ == 0) {
+        return chrono::nanoseconds(0);
+    }
+    uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100. * count_));
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return chrono::nanoseconds(GetBucketUpper(i));
+        }
+    }
+    return chrono::nanoseconds(GetBucketUpper(BUCKET_COUNT - 1));
+}
+
+void LatencyHistogram::Export(ostream &out) const {
+    out << "count " << count_ << '\n';
+    out << "p50 " << GetPercentile(50).count() << '\n';
+    out << "p95 " << GetPercentile(95).count() << '\n';
+    out << "p99 " << GetPercentile(99).count() << '\n';
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        if (buckets_[i] != 0) {
+            out << GetBucketLower(i) << ' ' << GetBucketUpper(i) << ' '
+                    << buckets_[i] << '\n';
+        }
+    }
+}
+
+// Значения меньше SUB_BUCKET_COUNT хранятся точно, остальные группируются
+// по старшему биту и следующим за ним SUB_BUCKET_BITS битам.
+int LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<int>(value);
+    }
+    int high_bit = 63;
+    while ((value >> high_bit) == 0) {
+        --high_bit;
+    }
+    int shift = high_bit - SUB_BUCKET_BITS;
+    int sub_bucket = static_cast<int>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+    return (shift + 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketLower(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    uint64_t sub_bucket = index % SUB_BUCKET_COUNT;
+    return (static_cast<uint64_t>(SUB_BUCKET_COUNT) + sub_bucket) << shift;
+}
+
+uint64_t LatencyHistogram::GetBucketUpper(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    return GetBucketLower(index) + (uint64_t(1) << shift) - 1;
+}
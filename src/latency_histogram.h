@@ -0,0 +1,42 @@
+#pragma once
+/*
+ * latency_histogram.h
+ *
+ *  Гистограмма задержек с логарифмическими корзинами: на каждую степень
+ *  двойки приходится SUB_BUCKET_COUNT корзин, поэтому относительная
+ *  погрешность перцентилей не превышает 1 / SUB_BUCKET_COUNT.
+ */
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+class LatencyHistogram {
+public:
+    void Add(std::chrono::nanoseconds value);
+    // Удаляет ранее добавленное значение (для скользящего окна запросов)
+    void Remove(std::chrono::nanoseconds value);
+    void Clear();
+    void Merge(const LatencyHistogram &other);
+
+    uint64_t GetCount() const;
+    // percentile задаётся в диапазоне [0, 100]
+    std::chrono::nanoseconds GetPercentile(double percentile) const;
+
+    // Выводит перцентили p50/p95/p99 и непустые корзины в формате
+    // "lower_ns upper_ns count", по одной на строку
+    void Export(std::ostream &out) const;
+
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1)
+            * SUB_BUCKET_COUNT;
+
+    static int GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketLower(int index);
+    static uint64_t GetBucketUpper(int index);
+
+    std::array<uint64_t, BUCKET_COUNT> buckets_ = { };
+    uint64_t count_ = 0;
+};
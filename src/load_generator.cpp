@@ -0,0 +1,218 @@
+/*
+ * load_generator.cpp
+ *
+ */
+#include "load_generator.h"
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "corpus_ingestor.h"
+#include "request_queue.h"
+
+using namespace std;
+
+namespace {
+
+long GetPeakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+long GetCurrentRssKb() {
+    ifstream statm("/proc/self/statm");
+    long total_pages = 0;
+    long resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void PrintMemoryUsage(const string &prefix, const MemoryUsage &usage,
+        ostream &out) {
+    out << prefix << "term_dictionary_bytes " << usage.term_dictionary << '\n';
+    out << prefix << "postings_bytes " << usage.postings << '\n';
+    out << prefix << "document_properties_bytes "
+            << usage.document_properties << '\n';
+    out << prefix << "document_ids_bytes " << usage.document_ids << '\n';
+    out << prefix << "stop_words_bytes " << usage.stop_words << '\n';
+    out << prefix << "total_bytes " << usage.GetTotal() << '\n';
+    out << prefix << "rss_kb " << GetCurrentRssKb() << '\n';
+}
+
+vector<string> ReadQueryLog(const string &path) {
+    ifstream input(path);
+    if (!input) {
+        throw runtime_error("Не удалось открыть файл `"s + path + "`."s);
+    }
+    vector<string> queries;
+    string line;
+    while (getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            queries.push_back(move(line));
+        }
+    }
+    return queries;
+}
+
+}
+
+double LoadReport::GetQps() const {
+    const double seconds = chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? requests / seconds : 0.;
+}
+
+void LoadReport::Print(ostream &out) const {
+    out << "requests " << requests << '\n';
+    out << "errors " << errors << '\n';
+    out << "qps " << GetQps() << '\n';
+    out << "latency_p50_us " << latency.GetPercentile(50).count() / 1000.
+            << '\n';
+    out << "latency_p99_us " << latency.GetPercentile(99).count() / 1000.
+            << '\n';
+    out << "latency_p999_us " << latency.GetPercentile(99.9).count() / 1000.
+            << '\n';
+    out << "empty_result_ratio " << empty_result_ratio << '\n';
+    out << "peak_rss_kb " << peak_rss_kb << '\n';
+}
+
+LoadReport ReplayQueryLog(const SearchServer &search_server,
+        const vector<string> &queries, const LoadGeneratorOptions &options) {
+    if (queries.empty()) {
+        throw invalid_argument("Журнал запросов пуст."s);
+    }
+    const size_t thread_count = max<size_t>(options.threads, 1);
+    const size_t total = options.warmup
+            + (options.requests != 0 ? options.requests : queries.size());
+
+    atomic<size_t> next_request { 0 };
+    mutex report_mutex;
+    LoadReport report;
+    size_t empty_results = 0;
+    chrono::steady_clock::time_point measure_start;
+    bool measure_started = false;
+
+    const auto start = chrono::steady_clock::now();
+    const auto interval = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::duration<double>(options.rate > 0 ? 1. / options.rate : 0.));
+
+    auto worker = [&] {
+        RequestQueue request_queue(search_server);
+        LatencyHistogram latency;
+        size_t requests = 0;
+        size_t errors = 0;
+        size_t empty = 0;
+        for (size_t index = next_request++; index < total;
+                index = next_request++) {
+            auto scheduled = chrono::steady_clock::now();
+            if (options.rate > 0) {
+                scheduled = start + interval * static_cast<long long>(index);
+                this_thread::sleep_until(scheduled);
+            }
+            if (index == options.warmup) {
+                lock_guard lock(report_mutex);
+                measure_start = scheduled;
+                measure_started = true;
+            }
+            // прогревочные запросы не попадают ни в задержки, ни в доли
+            const bool measured = index >= options.warmup;
+            try {
+                const bool found = !request_queue.AddFindRequest(
+                        queries[index % queries.size()]).empty();
+                if (measured) {
+                    latency.Add(chrono::steady_clock::now() - scheduled);
+                    empty += found ? 0 : 1;
+                }
+            } catch (const invalid_argument&) {
+                errors += measured ? 1 : 0;
+            }
+            requests += measured ? 1 : 0;
+        }
+        lock_guard lock(report_mutex);
+        report.latency.Merge(latency);
+        report.requests += requests;
+        report.errors += errors;
+        empty_results += empty;
+    };
+
+    vector<thread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+
+    report.elapsed = chrono::steady_clock::now()
+            - (measure_started ? measure_start : start);
+    const size_t completed = report.requests - report.errors;
+    report.empty_result_ratio =
+            completed > 0 ?
+                    static_cast<double>(empty_results) / completed : 0.;
+    report.peak_rss_kb = GetPeakRssKb();
+    return report;
+}
+
+int RunLoadGenerator(int argc, char *argv[]) {
+    string corpus_path;
+    string queries_path;
+    string stop_words;
+    LoadGeneratorOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const string arg = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("Не задано значение параметра "s + arg);
+            }
+            const string value = argv[++i];
+            if (arg == "--corpus"s) {
+                corpus_path = value;
+            } else if (arg == "--queries"s) {
+                queries_path = value;
+            } else if (arg == "--stop-words"s) {
+                stop_words = value;
+            } else if (arg == "--threads"s) {
+                options.threads = stoul(value);
+            } else if (arg == "--rate"s) {
+                options.rate = stod(value);
+            } else if (arg == "--requests"s) {
+                options.requests = stoul(value);
+            } else if (arg == "--warmup"s) {
+                options.warmup = stoul(value);
+            } else {
+                throw invalid_argument("Неизвестный параметр "s + arg);
+            }
+        }
+        if (corpus_path.empty() || queries_path.empty()) {
+            throw invalid_argument("Необходимо задать --corpus и --queries"s);
+        }
+
+        SearchServer search_server(stop_words);
+        const IngestionStats ingestion = CorpusIngestor(search_server).Ingest(
+                corpus_path);
+        cout << "documents " << ingestion.index.documents << '\n';
+        cout << "ingestion_ms "
+                << chrono::duration_cast<chrono::milliseconds>(
+                        ingestion.elapsed).count() << '\n';
+        PrintMemoryUsage("before_compact_"s, search_server.GetMemoryUsage(),
+                cout);
+        search_server.Compact();
+        PrintMemoryUsage("after_compact_"s, search_server.GetMemoryUsage(),
+                cout);
+
+        ReplayQueryLog(search_server, ReadQueryLog(queries_path), options).Print(
+                cout);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+/*
+ * load_generator.h
+ *
+ *  Нагрузочное тестирование: воспроизведение журнала запросов через
+ *  RequestQueue в нескольких потоках. Запуск из командной строки:
+ *
+ *      YaPrakticum_SearchEngine replay --corpus FILE --queries FILE
+ *              [--stop-words "и в на"] [--threads N] [--rate QPS]
+ *              [--requests N] [--warmup N]
+ *
+ *  Корпус задаётся в формате CorpusIngestor, журнал содержит по одному
+ *  запросу на строку. При --rate > 0 запросы поступают с заданной общей
+ *  частотой независимо от скорости ответов (открытая модель нагрузки),
+ *  и задержка отсчитывается от запланированного момента поступления.
+ *  При --rate 0 каждый поток отправляет запросы друг за другом.
+ */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "latency_histogram.h"
+#include "search_server.h"
+
+struct LoadGeneratorOptions {
+    size_t threads = 1;
+    // Суммарная частота запросов в секунду, 0 — без ограничения
+    double rate = 0.;
+    // Количество запросов, 0 — по размеру журнала
+    size_t requests = 0;
+    // Количество первых запросов, не попадающих в статистику
+    size_t warmup = 0;
+};
+
+struct LoadReport {
+    size_t requests = 0;
+    // Запросы, отклонённые сервером как некорректные
+    size_t errors = 0;
+    std::chrono::nanoseconds elapsed { 0 };
+    // Задержки выполненных запросов, без ошибочных
+    LatencyHistogram latency;
+    // Доля пустых результатов среди выполненных запросов после прогрева
+    double empty_result_ratio = 0.;
+    long peak_rss_kb = 0;
+
+    double GetQps() const;
+    void Print(std::ostream &out) const;
+};
+
+LoadReport ReplayQueryLog(const SearchServer &search_server,
+        const std::vector<std::string> &queries,
+        const LoadGeneratorOptions &options);
+
+// Точка входа команды replay, argv[0] — имя команды
+int RunLoadGenerator(int argc, char *argv[]);
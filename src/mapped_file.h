@@ -0,0 +1,23 @@
+#pragma once
+/*
+ * mapped_file.h
+ *
+ *  Файл, отображённый в память только для чтения.
+ */
+#include <string>
+#include <string_view>
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
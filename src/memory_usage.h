@@ -0,0 +1,48 @@
+#pragma once
+/*
+ * memory_usage.h
+ *
+ *  Подсчёт памяти, занятой структурами индекса. Учитываются байты,
+ *  запрошенные контейнерами у распределителя памяти, без служебных
+ *  данных самого распределителя.
+ */
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct MemoryUsage {
+    size_t term_dictionary = 0;
+    size_t postings = 0;
+    size_t document_properties = 0;
+    size_t document_ids = 0;
+    size_t stop_words = 0;
+    size_t caches = 0;
+
+    size_t GetTotal() const {
+        return term_dictionary + postings + document_properties + document_ids
+                + stop_words + caches;
+    }
+};
+
+template<typename T>
+size_t GetHeapSize(const std::vector<T> &container) {
+    return container.capacity() * sizeof(T);
+}
+
+// Короткие строки хранятся внутри объекта строки и не занимают кучу
+inline size_t GetHeapSize(const std::string &str) {
+    return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+}
+
+// Размер узла std::map/std::set: цвет и три указателя, затем значение
+template<typename Value>
+constexpr size_t GetTreeNodeSize() {
+    struct Node {
+        int color;
+        void *parent;
+        void *left;
+        void *right;
+        Value value;
+    };
+    return sizeof(Node);
+}
@@ -0,0 +1,180 @@
+#pragma once
+/*
+ * perfect_hash.h
+ *
+ *  Минимальная совершенная хеш-функция по схеме «хеш и смещение» (CHD).
+ *  Ключи распределяются по корзинам; корзины обрабатываются от больших
+ *  к меньшим, и для каждой подбирается смещение, при котором все её ключи
+ *  попадают в свободные и различные ячейки. Поиск ключа — одно вычисление
+ *  хеша, чтение смещения корзины и перемешивание.
+ *
+ *  Все функции constexpr, поэтому таблица для известного при компиляции
+ *  списка строится компилятором (StaticStopWordFilter).
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace perfect_hash {
+
+// Число попыток подобрать смещение корзины
+constexpr uint32_t MAX_DISPLACEMENT = 1u << 20;
+// Число затравок хеша, которые перебираются, если таблица не строится:
+// у двух разных ключей совпали 64-битные хеши или не нашлось смещения
+constexpr uint64_t MAX_SEED_ATTEMPTS = 16;
+
+// Завершающее перемешивание splitmix64
+constexpr uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// FNV-1a; затравка меняет начальное значение
+constexpr uint64_t HashBytes(std::string_view bytes, uint64_t seed = 0) {
+    uint64_t hash = 14695981039346656037ull ^ Mix(seed);
+    for (const char c : bytes) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Средний размер корзины — два ключа
+constexpr size_t GetBucketCount(size_t key_count) {
+    return key_count / 2 + 1;
+}
+
+constexpr size_t GetBucket(uint64_t hash, size_t bucket_count) {
+    return Mix(hash) % bucket_count;
+}
+
+constexpr size_t GetSlot(uint64_t hash, uint32_t displacement,
+        size_t slot_count) {
+    return Mix(hash + (displacement + 1ull) * 0x9E3779B97F4A7C15ull)
+            % slot_count;
+}
+
+// Подбирает смещения корзин для key_count ключей с хешами hashes.
+// slot_keys (key_count элементов) получает номер ключа каждой ячейки.
+// Рабочие массивы: bucket_keys — key_count элементов, bucket_starts —
+// bucket_count + 1, bucket_order — bucket_count.
+// Возвращает false, если хеши ключей совпадают или смещение не найдено;
+// тогда таблица строится заново с другой затравкой.
+constexpr bool AssignSlots(const uint64_t *hashes, size_t key_count,
+        uint32_t *displacements, size_t bucket_count, int *slot_keys,
+        size_t *bucket_keys, size_t *bucket_starts, size_t *bucket_order) {
+    // группировка ключей по корзинам подсчётом
+    for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+        bucket_starts[bucket] = 0;
+    }
+    for (size_t key = 0; key < key_count; ++key) {
+        ++bucket_starts[GetBucket(hashes[key], bucket_count) + 1];
+        slot_keys[key] = -1;
+    }
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bucket_starts[bucket + 1] += bucket_starts[bucket];
+        bucket_order[bucket] = 0;
+        displacements[bucket] = 0;
+    }
+    for (size_t key = 0; key < key_count; ++key) {
+        const size_t bucket = GetBucket(hashes[key], bucket_count);
+        // bucket_starts[bucket] временно служит позицией записи
+        bucket_keys[bucket_starts[bucket]++] = key;
+    }
+    for (size_t bucket = bucket_count; bucket > 0; --bucket) {
+        bucket_starts[bucket] = bucket_starts[bucket - 1];
+    }
+    bucket_starts[0] = 0;
+
+    auto bucket_size = [bucket_starts](size_t bucket) {
+        return bucket_starts[bucket + 1] - bucket_starts[bucket];
+    };
+    // порядок по убыванию размера корзины; размеры корзин малы,
+    // поэтому достаточно одного прохода на каждый размер
+    size_t max_size = 0;
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        if (bucket_size(bucket) > max_size) {
+            max_size = bucket_size(bucket);
+        }
+    }
+    size_t ordered = 0;
+    for (size_t size = max_size; size > 0; --size) {
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            if (bucket_size(bucket) == size) {
+                bucket_order[ordered++] = bucket;
+            }
+        }
+    }
+
+    for (size_t order = 0; order < ordered; ++order) {
+        const size_t bucket = bucket_order[order];
+        const size_t first = bucket_starts[bucket];
+        const size_t last = bucket_starts[bucket + 1];
+        // одинаковые хеши попадают в одну корзину
+        for (size_t i = first; i < last; ++i) {
+            for (size_t j = i + 1; j < last; ++j) {
+                if (hashes[bucket_keys[i]] == hashes[bucket_keys[j]]) {
+                    return false;
+                }
+            }
+        }
+        bool placed = false;
+        for (uint32_t displacement = 0;
+                !placed && displacement < MAX_DISPLACEMENT; ++displacement) {
+            size_t i = first;
+            for (; i < last; ++i) {
+                const size_t slot = GetSlot(hashes[bucket_keys[i]],
+                        displacement, key_count);
+                if (slot_keys[slot] != -1) {
+                    break;
+                }
+                slot_keys[slot] = static_cast<int>(bucket_keys[i]);
+            }
+            if (i == last) {
+                displacements[bucket] = displacement;
+                placed = true;
+                continue;
+            }
+            // освобождаем ячейки, занятые ключами корзины в этой попытке
+            for (size_t undo = first; undo < i; ++undo) {
+                slot_keys[GetSlot(hashes[bucket_keys[undo]], displacement,
+                        key_count)] = -1;
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Отсев по длине и первому байту: большинство слов, которых нет в наборе,
+// отбрасывается без хеширования
+class Prefilter {
+public:
+    constexpr void Add(std::string_view word) {
+        length_mask_ |= GetLengthBit(word.size());
+        const uint8_t first = word.empty() ? 0 : static_cast<uint8_t>(word[0]);
+        first_byte_mask_[first / 64] |= 1ull << (first % 64);
+    }
+
+    constexpr bool MayContain(std::string_view word) const {
+        if ((length_mask_ & GetLengthBit(word.size())) == 0) {
+            return false;
+        }
+        const uint8_t first = word.empty() ? 0 : static_cast<uint8_t>(word[0]);
+        return (first_byte_mask_[first / 64] >> (first % 64)) & 1;
+    }
+
+private:
+    // длины от 63 байт и больше делят один бит
+    static constexpr uint64_t GetLengthBit(size_t length) {
+        return 1ull << (length < 63 ? length : 63);
+    }
+
+    uint64_t length_mask_ = 0;
+    uint64_t first_byte_mask_[4] = { };
+};
+
+}
@@ -0,0 +1,21 @@
+/*
+ * process_queries.cpp
+ *
+ */
+#include "process_queries.h"
+
+using namespace std;
+
+vector<vector<Document>> ProcessQueries(const SearchServer &server,
+        const vector<string> &queries) {
+    return server.FindTopDocumentsBatch(queries);
+}
+
+vector<Document> ProcessQueriesJoined(const SearchServer &server,
+        const vector<string> &queries) {
+    vector<Document> result;
+    for (vector<Document> &documents : ProcessQueries(server, queries)) {
+        result.insert(result.end(), documents.begin(), documents.end());
+    }
+    return result;
+}
@@ -0,0 +1,19 @@
+#pragma once
+/*
+ * process_queries.h
+ *
+ *  Обработка пакета запросов к поисковому серверу.
+ */
+#include <string>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Результаты запросов в порядке запросов. Запросы с общими словами
+// выполняются совместным просмотром списков документов
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer &server,
+        const std::vector<std::string> &queries);
+
+// Результаты всех запросов подряд в одном векторе
+std::vector<Document> ProcessQueriesJoined(const SearchServer &server,
+        const std::vector<std::string> &queries);
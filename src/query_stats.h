@@ -0,0 +1,114 @@
+#pragma once
+/*
+ * query_stats.h
+ *
+ *  Статистика выполнения одного поискового запроса.
+ *  Сбор статистики включается на этапе компиляции: поиск параметризуется
+ *  типом сборщика, и для NoQueryStats все вызовы превращаются в пустые
+ *  inline-функции, которые компилятор полностью удаляет.
+ */
+#include <chrono>
+#include <cstddef>
+
+enum class QueryStage {
+    PARSE, SCORE, FILTER, RANK
+};
+
+const int QUERY_STAGE_COUNT = 4;
+
+struct QueryStats {
+    size_t terms_resolved = 0;     // слова запроса, найденные в индексе
+    size_t postings_scanned = 0;   // просмотренные элементы списков документов
+    size_t candidates = 0;         // накопленные документы-кандидаты
+    size_t minus_eliminated = 0;   // кандидаты, отброшенные минус-словами
+    size_t filter_rejected = 0;    // кандидаты, отброшенные фильтром
+    std::chrono::nanoseconds stage_time[QUERY_STAGE_COUNT] = { };
+
+    std::chrono::nanoseconds GetStageTime(QueryStage stage) const {
+        return stage_time[static_cast<int>(stage)];
+    }
+
+    std::chrono::nanoseconds GetTotalTime() const {
+        std::chrono::nanoseconds total { 0 };
+        for (const auto &time : stage_time) {
+            total += time;
+        }
+        return total;
+    }
+};
+
+// Сборщик-заглушка, используется по умолчанию.
+struct NoQueryStats {
+    static constexpr bool enabled = false;
+
+    void AddTermsResolved(size_t) {
+    }
+    void AddPostingsScanned(size_t) {
+    }
+    void AddCandidates(size_t) {
+    }
+    void AddMinusEliminated(size_t) {
+    }
+    void AddFilterRejected(size_t) {
+    }
+    void AddStageTime(QueryStage, std::chrono::nanoseconds) {
+    }
+};
+
+class QueryStatsCollector {
+public:
+    static constexpr bool enabled = true;
+
+    explicit QueryStatsCollector(QueryStats &stats) :
+            stats_(stats) {
+    }
+
+    void AddTermsResolved(size_t count) {
+        stats_.terms_resolved += count;
+    }
+    void AddPostingsScanned(size_t count) {
+        stats_.postings_scanned += count;
+    }
+    void AddCandidates(size_t count) {
+        stats_.candidates += count;
+    }
+    void AddMinusEliminated(size_t count) {
+        stats_.minus_eliminated += count;
+    }
+    void AddFilterRejected(size_t count) {
+        stats_.filter_rejected += count;
+    }
+    void AddStageTime(QueryStage stage, std::chrono::nanoseconds time) {
+        stats_.stage_time[static_cast<int>(stage)] += time;
+    }
+
+private:
+    QueryStats &stats_;
+};
+
+// Замеряет время этапа от создания до разрушения объекта.
+template<typename StatsCollector>
+class StageTimer {
+public:
+    StageTimer(StatsCollector &collector, QueryStage stage) :
+            collector_(collector), stage_(stage) {
+        if constexpr (StatsCollector::enabled) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if constexpr (StatsCollector::enabled) {
+            collector_.AddStageTime(stage_,
+                    std::chrono::steady_clock::now() - start_);
+        }
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    StatsCollector &collector_;
+    QueryStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,97 @@
+#pragma once
+/*
+ * ranking_policy.h
+ *
+ *  Политики ранжирования для поиска. Политика передаётся параметром шаблона
+ *  FindTopDocuments и полностью встраивается во внутренний цикл подсчёта
+ *  релевантности. Политика объявляет, какие статистики документа ей нужны:
+ *  при uses_document_length = false длины документов не читаются.
+ *
+ *  Требования к политике:
+ *      static constexpr bool uses_document_length;
+ *      static double ComputeIdf(int document_count, int document_freq);
+ *      static double ComputeScore(double tf, double idf, int document_length,
+ *              double average_document_length);
+ *      // Верхняя граница ComputeScore для любого документа с частотой
+ *      // не больше max_tf; используется отсечением по первому уровню индекса
+ *      static double ComputeScoreBound(double max_tf, double idf,
+ *              double average_document_length);
+ *      static bool IsBetter(const Document &lhs, const Document &rhs);
+ */
+#include <cmath>
+#include "document.h"
+
+const double EPSILON = 1e-6;
+
+// Порядок выдачи по умолчанию: по убыванию релевантности,
+// при равной релевантности — по убыванию рейтинга
+struct RelevanceOrdering {
+    static bool IsBetter(const Document &lhs, const Document &rhs) {
+        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.relevance > rhs.relevance;
+    }
+};
+
+// Итоговый порядок выдачи: порядок политики, при равенстве — по возрастанию
+// идентификатора документа. Выдача и отбор лучших документов не зависят
+// от порядка перебора кандидатов, то есть от внутренних идентификаторов
+template<typename RankingPolicy>
+struct IdTieBreakOrdering {
+    static bool IsBetter(const Document &lhs, const Document &rhs) {
+        if (RankingPolicy::IsBetter(lhs, rhs)) {
+            return true;
+        }
+        return !RankingPolicy::IsBetter(rhs, lhs) && lhs.id < rhs.id;
+    }
+};
+
+struct TfIdfRanking: RelevanceOrdering {
+    static constexpr bool uses_document_length = false;
+
+    static double ComputeIdf(int document_count, int document_freq) {
+        return std::log(
+                static_cast<double>(document_count)
+                        / static_cast<double>(document_freq));
+    }
+
+    static double ComputeScore(double tf, double idf, int, double) {
+        return idf * tf;
+    }
+
+    static double ComputeScoreBound(double max_tf, double idf, double) {
+        return idf * max_tf;
+    }
+};
+
+// Okapi BM25 с параметрами k1 = 1.2, b = 0.75
+struct Bm25Ranking: RelevanceOrdering {
+    static constexpr bool uses_document_length = true;
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    static double ComputeIdf(int document_count, int document_freq) {
+        return std::log(
+                1. + (document_count - document_freq + 0.5)
+                        / (document_freq + 0.5));
+    }
+
+    // tf хранится в индексе как доля вхождений слова среди слов документа
+    static double ComputeScore(double tf, double idf, int document_length,
+            double average_document_length) {
+        const double count = tf * document_length;
+        const double norm = K1
+                * (1. - B + B * document_length / average_document_length);
+        return idf * count * (K1 + 1.) / (count + norm);
+    }
+
+    // Оценка равна idf * (k1 + 1) * tf / (tf + k1 * (1 - b) / length
+    // + k1 * b / average_length) и растёт с tf; слагаемое с длиной
+    // документа неотрицательно и отбрасывается
+    static double ComputeScoreBound(double max_tf, double idf,
+            double average_document_length) {
+        return idf * (K1 + 1.) * max_tf
+                / (max_tf + K1 * B / average_document_length);
+    }
+};
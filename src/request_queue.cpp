@@ -8,34 +8,289 @@
 #include "request_queue.h"
 #include "search_server.h"
 
+#include <algorithm>
+
+RequestQueue::RequestQueue(const SearchServer &search_server,
+        AdmissionOptions options, bool collect_stats) :
+        search_server_(search_server), collect_stats_(collect_stats),
+        options_(options), pool_(std::make_unique<ThreadPool>(
+                std::max<size_t>(options.max_concurrency, 1))) {
+}
+
+RequestQueue::~RequestQueue() {
+    Wait();
+}
+
+std::future<ScheduledResult> RequestQueue::SubmitFindRequest(
+        const std::string &raw_query, DocumentStatus status,
+        RequestPriority priority) {
+    return Schedule(raw_query,
+            MakeScheduledSearch(raw_query,
+                    [status](int, DocumentStatus document_status, int) {
+                        return document_status == status;
+                    }), priority);
+}
+
+std::future<ScheduledResult> RequestQueue::SubmitFindRequest(
+        const std::string &raw_query, RequestPriority priority) {
+    return SubmitFindRequest(raw_query, DocumentStatus::ACTUAL, priority);
+}
+
+void RequestQueue::Wait() {
+    std::unique_lock lock(schedule_mutex_);
+    idle_.wait(lock, [this] {
+        return in_flight_ == 0;
+    });
+}
+
+std::future<ScheduledResult> RequestQueue::Schedule(
+        const std::string &raw_query, ScheduledSearch search,
+        RequestPriority priority) {
+    using namespace std::literals;
+    if (!pool_) {
+        throw std::logic_error(
+                "Очередь создана без параметров планировщика."s);
+    }
+    // выбрасывает invalid_argument для некорректного запроса
+    const size_t cost = search_server_.EstimateQueryCost(raw_query);
+
+    PendingRequest request { std::move(search), priority, cost, Clock::now(),
+            std::promise<ScheduledResult>() };
+    std::future<ScheduledResult> result = request.promise.get_future();
+    // вытесненный или новый запрос, который не будет выполнен
+    std::promise<ScheduledResult> rejected;
+    bool has_rejected = false;
+    bool admitted = true;
+    {
+        std::lock_guard lock(schedule_mutex_);
+        if (pending_count_ >= options_.max_pending) {
+            has_rejected = true;
+            std::deque<PendingRequest> *queue = nullptr;
+            std::deque<PendingRequest>::iterator victim;
+            if (FindVictim(priority, cost, queue, victim)) {
+                rejected = std::move(victim->promise);
+                queue->erase(victim);
+                --pending_count_;
+                --in_flight_;
+            } else {
+                rejected = std::move(request.promise);
+                admitted = false;
+            }
+        }
+        if (admitted) {
+            pending_[static_cast<int>(priority)].push_back(std::move(request));
+            ++pending_count_;
+            ++in_flight_;
+        }
+    }
+    if (has_rejected) {
+        {
+            std::lock_guard lock(stats_mutex_);
+            ++rejected_requests_;
+        }
+        ScheduledResult rejected_result;
+        rejected_result.outcome = RequestOutcome::REJECTED;
+        rejected.set_value(std::move(rejected_result));
+    }
+    if (admitted) {
+        // задач в пуле столько же, сколько принятых запросов; каждая
+        // выполняет лучший из ожидающих к моменту её запуска запрос
+        pool_->Submit([this] {
+            RunNextScheduled();
+        });
+    }
+    return result;
+}
+
+bool RequestQueue::FindVictim(RequestPriority priority, size_t cost,
+        std::deque<PendingRequest> *&queue,
+        std::deque<PendingRequest>::iterator &victim) {
+    for (int level = REQUEST_PRIORITY_COUNT - 1;
+            level >= static_cast<int>(priority); --level) {
+        std::deque<PendingRequest> &requests = pending_[level];
+        auto most_expensive = std::max_element(requests.begin(),
+                requests.end(),
+                [](const PendingRequest &lhs, const PendingRequest &rhs) {
+                    return lhs.cost < rhs.cost;
+                });
+        if (most_expensive == requests.end()) {
+            continue;
+        }
+        // при равном приоритете вытесняется только более дорогой запрос
+        if (level > static_cast<int>(priority)
+                || most_expensive->cost > cost) {
+            queue = &requests;
+            victim = most_expensive;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+void RequestQueue::RunNextScheduled() {
+    PendingRequest request;
+    {
+        std::lock_guard lock(schedule_mutex_);
+        if (pending_count_ == 0) {
+            return;
+        }
+        for (std::deque<PendingRequest> &requests : pending_) {
+            if (!requests.empty()) {
+                request = std::move(requests.front());
+                requests.pop_front();
+                break;
+            }
+        }
+        --pending_count_;
+    }
+
+    const Clock::time_point start = Clock::now();
+    QueryStats stats;
+    ScheduledResult result;
+    result.queue_delay = start - request.enqueued;
+    // при перегрузке ограничивается только дорогая работа не HIGH
+    const bool shed = result.queue_delay > options_.target_queue_delay
+            && request.priority != RequestPriority::HIGH
+            && request.cost >= options_.expensive_cost;
+    if (shed && request.priority == RequestPriority::LOW) {
+        result.outcome = RequestOutcome::REJECTED;
+    } else {
+        Clock::time_point deadline = Clock::time_point::max();
+        if (shed) {
+            deadline = start + options_.degraded_budget;
+        }
+        bool truncated = false;
+        try {
+            result.documents = request.search(deadline, truncated,
+                    collect_stats_ ? &stats : nullptr);
+        } catch (...) {
+            request.promise.set_exception(std::current_exception());
+            FinishScheduled();
+            return;
+        }
+        if (truncated) {
+            result.outcome = RequestOutcome::DEGRADED;
+        }
+    }
+
+    if (result.outcome == RequestOutcome::REJECTED) {
+        std::lock_guard lock(stats_mutex_);
+        ++rejected_requests_;
+    } else {
+        if (result.outcome == RequestOutcome::DEGRADED) {
+            std::lock_guard lock(stats_mutex_);
+            ++degraded_requests_;
+        }
+        ProcessResultRequest(result.documents, Clock::now() - start, stats,
+                result.queue_delay);
+    }
+    request.promise.set_value(std::move(result));
+    FinishScheduled();
+}
+
+void RequestQueue::FinishScheduled() {
+    {
+        std::lock_guard lock(schedule_mutex_);
+        --in_flight_;
+    }
+    idle_.notify_all();
+}
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query,
         DocumentStatus status) {
-    const std::vector<Document> &v_res = search_server_.FindTopDocuments(
-            raw_query, status);
-    ProcessResultRequest(v_res);
-    return v_res;
+    return RunRequest([&](auto &... stats) {
+        return search_server_.FindTopDocuments(raw_query, status, stats...);
+    });
 }
 std::vector<Document> RequestQueue::AddFindRequest(
         const std::string &raw_query) {
-    const std::vector<Document> &v_res = search_server_.FindTopDocuments(
-            raw_query);
-    ProcessResultRequest(v_res);
-    return v_res;
+    return RunRequest([&](auto &... stats) {
+        return search_server_.FindTopDocuments(raw_query, stats...);
+    });
 }
 int RequestQueue::GetNoResultRequests() const {
+    std::lock_guard lock(stats_mutex_);
     return number_empty_requests_;
 }
 
-void RequestQueue::ProcessResultRequest(const std::vector<Document> &v_res) {
+int RequestQueue::GetRequestCount() const {
+    std::lock_guard lock(stats_mutex_);
+    return current_number_requests_;
+}
+
+int RequestQueue::GetRejectedRequests() const {
+    std::lock_guard lock(stats_mutex_);
+    return rejected_requests_;
+}
+
+int RequestQueue::GetDegradedRequests() const {
+    std::lock_guard lock(stats_mutex_);
+    return degraded_requests_;
+}
+
+const LatencyHistogram& RequestQueue::GetQueueDelayHistogram() const {
+    return queue_delay_;
+}
+
+const LatencyHistogram& RequestQueue::GetLatencyHistogram() const {
+    return total_latency_;
+}
+
+const LatencyHistogram& RequestQueue::GetLatencyHistogram(
+        QueryStage stage) const {
+    return stage_latency_[static_cast<int>(stage)];
+}
+
+void RequestQueue::ExportLatencyHistograms(std::ostream &out) const {
+    static const char *stage_names[QUERY_STAGE_COUNT] = { "parse", "score",
+            "filter", "rank" };
+    out << "[total]\n";
+    total_latency_.Export(out);
+    for (int i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        out << '[' << stage_names[i] << "]\n";
+        stage_latency_[i].Export(out);
+    }
+}
+
+void RequestQueue::ProcessResultRequest(const std::vector<Document> &v_res,
+        std::chrono::nanoseconds latency, const QueryStats &stats,
+        std::chrono::nanoseconds queue_delay) {
     QueryResult query_result;
     if (v_res.empty()) {
-        query_result = { v_res, true };
+        query_result = { v_res, true, latency, stats, queue_delay };
     } else {
-        query_result = { v_res, false };
+        query_result = { v_res, false, latency, stats, queue_delay };
     }
+    std::lock_guard lock(stats_mutex_);
     Push(query_result);
 }
 
+void RequestQueue::AddToHistograms(const QueryResult &query_result) {
+    if (pool_) {
+        queue_delay_.Add(query_result.queue_delay);
+    }
+    if (!collect_stats_) {
+        return;
+    }
+    total_latency_.Add(query_result.latency);
+    for (int i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        stage_latency_[i].Add(query_result.stats.stage_time[i]);
+    }
+}
+
+void RequestQueue::RemoveFromHistograms(const QueryResult &query_result) {
+    if (pool_) {
+        queue_delay_.Remove(query_result.queue_delay);
+    }
+    if (!collect_stats_) {
+        return;
+    }
+    total_latency_.Remove(query_result.latency);
+    for (int i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        stage_latency_[i].Remove(query_result.stats.stage_time[i]);
+    }
+}
+
 void RequestQueue::Push(QueryResult query_result) {
     if (min_in_day_ > current_number_requests_) {
         requests_.push_back(query_result); // @suppress("Invalid arguments")
@@ -44,8 +299,10 @@ void RequestQueue::Push(QueryResult query_result) {
         requests_.push_back(query_result); // @suppress("Invalid arguments")
         if (requests_.front().request_empty) // @suppress("Field cannot be resolved")
             --number_empty_requests_; // Уменьшаем количество пустых слов
+        RemoveFromHistograms(requests_.front());
         requests_.pop_front();
     }
+    AddToHistograms(query_result);
     if (query_result.request_empty)
         ++number_empty_requests_; // Увеличиваем количество пустых запросов
 
@@ -8,16 +8,89 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include "search_server.h"
+#include "query_stats.h"
+#include "latency_histogram.h"
+#include "thread_pool.h"
 
 #include "document.h"
 
+enum class RequestPriority {
+    HIGH, NORMAL, LOW
+};
+
+const int REQUEST_PRIORITY_COUNT = 3;
+
+// Параметры планировщика запросов
+struct AdmissionOptions {
+    // Наибольшее число запросов, ожидающих выполнения
+    size_t max_pending = 1024;
+    // Наибольшее число одновременно выполняемых запросов
+    size_t max_concurrency = std::thread::hardware_concurrency();
+    // Если запрос ждал в очереди дольше, очередь считается перегруженной
+    std::chrono::microseconds target_queue_delay { 20000 };
+    // Запрос с оценкой стоимости не меньше этой считается дорогим
+    size_t expensive_cost = 10000;
+    // Время, за которое выполняется запрос с пониженным качеством
+    std::chrono::microseconds degraded_budget { 5000 };
+};
+
+enum class RequestOutcome {
+    COMPLETED,
+    // выполнен с ограничением времени, результат может быть неполным
+    DEGRADED,
+    // отклонён без выполнения
+    REJECTED
+};
+
+struct ScheduledResult {
+    std::vector<Document> documents;
+    RequestOutcome outcome = RequestOutcome::COMPLETED;
+    std::chrono::nanoseconds queue_delay { 0 };
+};
+
 class RequestQueue {
 public:
 
-    explicit RequestQueue(const SearchServer &search_server) :
-            search_server_(search_server) {
+    // При collect_stats = true для каждого запроса собирается QueryStats,
+    // а задержки запросов текущего окна попадают в гистограммы
+    explicit RequestQueue(const SearchServer &search_server,
+            bool collect_stats = false) :
+            search_server_(search_server), collect_stats_(collect_stats) {
     }
+    // Очередь с планировщиком: запросы SubmitFindRequest выполняются в пуле
+    // из options.max_concurrency потоков в порядке приоритета
+    RequestQueue(const SearchServer &search_server, AdmissionOptions options,
+            bool collect_stats = false);
+    // Дожидается выполнения запланированных запросов
+    ~RequestQueue();
+
+    // Запрос ставится в ограниченную очередь. Если очередь заполнена,
+    // отклоняется самый дорогой запрос наименьшего приоритета — ожидающий
+    // или новый. Если к началу выполнения запрос ждал дольше
+    // target_queue_delay, дорогой запрос LOW отклоняется, а дорогой запрос
+    // NORMAL выполняется с ограничением времени degraded_budget; дешёвые
+    // запросы и запросы HIGH выполняются полностью.
+    // Ошибка разбора запроса выбрасывается сразу.
+    template<typename DocumentPredicate>
+    std::future<ScheduledResult> SubmitFindRequest(const std::string &raw_query,
+            DocumentPredicate document_predicate,
+            RequestPriority priority = RequestPriority::NORMAL);
+    std::future<ScheduledResult> SubmitFindRequest(const std::string &raw_query,
+            DocumentStatus status,
+            RequestPriority priority = RequestPriority::NORMAL);
+    std::future<ScheduledResult> SubmitFindRequest(const std::string &raw_query,
+            RequestPriority priority = RequestPriority::NORMAL);
+    // Дожидается выполнения всех запланированных запросов
+    void Wait();
     // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template<typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string &raw_query,
@@ -26,13 +99,66 @@ public:
             DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string &raw_query);
     int GetNoResultRequests() const;
+    // Количество запросов в текущем окне
+    int GetRequestCount() const;
+    // Запланированные запросы, отклонённые за всё время работы очереди
+    int GetRejectedRequests() const;
+    // Запланированные запросы, прерванные по ограничению времени
+    int GetDegradedRequests() const;
+    // Гистограмма ожидания в очереди запросов окна. Гистограммы читаются,
+    // когда запланированных запросов нет, например после Wait()
+    const LatencyHistogram& GetQueueDelayHistogram() const;
+
+    // Гистограмма полного времени выполнения запросов окна
+    const LatencyHistogram& GetLatencyHistogram() const;
+    // Гистограмма времени отдельного этапа выполнения запросов окна
+    const LatencyHistogram& GetLatencyHistogram(QueryStage stage) const;
+    void ExportLatencyHistograms(std::ostream &out) const;
+
     const SearchServer &search_server_;
 private:
+    using Clock = std::chrono::steady_clock;
+    // Поиск со сроком выполнения; Clock::time_point::max() — без срока.
+    // Статистика собирается, если stats не равен nullptr
+    using ScheduledSearch = std::function<std::vector<Document>(
+            Clock::time_point deadline, bool &truncated, QueryStats *stats)>;
+
     struct QueryResult {
         std::vector<Document> query;
         bool request_empty;
+        std::chrono::nanoseconds latency { 0 };
+        QueryStats stats;
+        std::chrono::nanoseconds queue_delay { 0 };
     };
-    void ProcessResultRequest(const std::vector<Document> &v_res);
+
+    struct PendingRequest {
+        ScheduledSearch search;
+        RequestPriority priority;
+        size_t cost;
+        Clock::time_point enqueued;
+        std::promise<ScheduledResult> promise;
+    };
+
+    template<typename Search>
+    std::vector<Document> RunRequest(Search search);
+    template<typename DocumentPredicate>
+    ScheduledSearch MakeScheduledSearch(const std::string &raw_query,
+            DocumentPredicate document_predicate) const;
+    std::future<ScheduledResult> Schedule(const std::string &raw_query,
+            ScheduledSearch search, RequestPriority priority);
+    // Ищет самый дорогой ожидающий запрос, который можно вытеснить запросом
+    // с приоритетом priority и стоимостью cost
+    bool FindVictim(RequestPriority priority, size_t cost,
+            std::deque<PendingRequest>*&queue,
+            std::deque<PendingRequest>::iterator &victim);
+    void RunNextScheduled();
+    void FinishScheduled();
+    void ProcessResultRequest(const std::vector<Document> &v_res,
+            std::chrono::nanoseconds latency = std::chrono::nanoseconds(0),
+            const QueryStats &stats = QueryStats(),
+            std::chrono::nanoseconds queue_delay = std::chrono::nanoseconds(0));
+    void AddToHistograms(const QueryResult &query_result);
+    void RemoveFromHistograms(const QueryResult &query_result);
 
     void Push(QueryResult query_result);
 
@@ -41,13 +167,83 @@ private:
     int current_number_requests_ = 0;
     int number_empty_requests_ = 0;
 
+    bool collect_stats_ = false;
+    LatencyHistogram total_latency_;
+    LatencyHistogram stage_latency_[QUERY_STAGE_COUNT];
+    LatencyHistogram queue_delay_;
+    // Запросы пула завершаются параллельно; защищает окно запросов,
+    // счётчики и гистограммы
+    mutable std::mutex stats_mutex_;
+    int rejected_requests_ = 0;
+    int degraded_requests_ = 0;
+
+    AdmissionOptions options_;
+    std::mutex schedule_mutex_;
+    std::condition_variable idle_;
+    std::deque<PendingRequest> pending_[REQUEST_PRIORITY_COUNT];
+    size_t pending_count_ = 0;
+    // Принятые и ещё не завершённые запросы
+    size_t in_flight_ = 0;
+    // Объявлен последним, чтобы потоки завершились раньше остальных полей
+    std::unique_ptr<ThreadPool> pool_;
 };
 
 template<typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query,
         DocumentPredicate document_predicate) {
-    const std::vector<Document> &v_res = search_server_.FindTopDocuments(
-            raw_query, document_predicate);
-    ProcessResultRequest(v_res);
+    return RunRequest([&](auto &... stats) {
+        return search_server_.FindTopDocuments(raw_query, document_predicate,
+                stats...);
+    });
+}
+
+template<typename DocumentPredicate>
+std::future<ScheduledResult> RequestQueue::SubmitFindRequest(
+        const std::string &raw_query, DocumentPredicate document_predicate,
+        RequestPriority priority) {
+    return Schedule(raw_query,
+            MakeScheduledSearch(raw_query, document_predicate), priority);
+}
+
+template<typename DocumentPredicate>
+RequestQueue::ScheduledSearch RequestQueue::MakeScheduledSearch(
+        const std::string &raw_query,
+        DocumentPredicate document_predicate) const {
+    const SearchServer &server = search_server_;
+    return [&server, raw_query, document_predicate](
+            Clock::time_point deadline, bool &truncated, QueryStats *stats) {
+        if (deadline == Clock::time_point::max()) {
+            if (stats) {
+                return server.FindTopDocuments(raw_query, document_predicate,
+                        *stats);
+            }
+            return server.FindTopDocuments(raw_query, document_predicate);
+        }
+        const auto should_stop = [deadline] {
+            return Clock::now() >= deadline;
+        };
+        if (stats) {
+            return server.FindTopDocuments(raw_query, document_predicate,
+                    should_stop, truncated, *stats);
+        }
+        return server.FindTopDocuments(raw_query, document_predicate,
+                should_stop, truncated);
+    };
+}
+
+// search вызывается либо без аргументов, либо с QueryStats&,
+// если очередь собирает статистику
+template<typename Search>
+std::vector<Document> RequestQueue::RunRequest(Search search) {
+    if (!collect_stats_) {
+        const std::vector<Document> v_res = search();
+        ProcessResultRequest(v_res);
+        return v_res;
+    }
+    QueryStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<Document> v_res = search(stats);
+    ProcessResultRequest(v_res, std::chrono::steady_clock::now() - start,
+            stats);
     return v_res;
 }
@@ -0,0 +1,113 @@
+#pragma once
+/*
+ * score_accumulator.h
+ *
+ *  Накопитель релевантности документов запроса, индексируемый внутренними
+ *  идентификаторами документов. Массивы переиспользуются между запросами:
+ *  Reset очищает только затронутые предыдущим запросом элементы.
+ *  Память всех живых накопителей суммируется в общем счётчике, чтобы её
+ *  можно было учесть в статистике памяти сервера.
+ */
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+class ScoreAccumulator {
+public:
+    ScoreAccumulator() = default;
+
+    ScoreAccumulator(ScoreAccumulator &&other) noexcept :
+            scores_(std::move(other.scores_)), state_(
+                    std::move(other.state_)), touched_(
+                    std::move(other.touched_)), counted_bytes_(
+                    std::exchange(other.counted_bytes_, 0)) {
+    }
+
+    ScoreAccumulator& operator=(ScoreAccumulator&&) = delete;
+
+    ~ScoreAccumulator() {
+        total_memory_usage_ -= counted_bytes_;
+    }
+
+    void Reset(size_t document_count) {
+        if (state_.size() > 2 * document_count) {
+            // накопитель потока остался от поиска по большему индексу
+            std::vector<double>().swap(scores_);
+            std::vector<State>().swap(state_);
+            std::vector<int>().swap(touched_);
+        }
+        for (const int document_id : touched_) {
+            state_[document_id] = EMPTY;
+        }
+        touched_.clear();
+        if (state_.size() < document_count) {
+            state_.resize(document_count, EMPTY);
+            scores_.resize(document_count);
+        }
+        UpdateMemoryUsage();
+    }
+
+    void Add(int document_id, double score) {
+        if (state_[document_id] == EMPTY) {
+            state_[document_id] = ACTIVE;
+            scores_[document_id] = 0.;
+            touched_.push_back(document_id);
+        }
+        scores_[document_id] += score;
+    }
+
+    // Исключает документ из результата, возвращает true, если он был кандидатом
+    bool Remove(int document_id) {
+        if (state_[document_id] != ACTIVE) {
+            return false;
+        }
+        state_[document_id] = REMOVED;
+        return true;
+    }
+
+    size_t GetCandidateCount() const {
+        return touched_.size();
+    }
+
+    // Перебирает оставшиеся кандидаты по возрастанию идентификатора
+    template<typename Callback>
+    void ForEach(Callback callback) {
+        std::sort(touched_.begin(), touched_.end());
+        for (const int document_id : touched_) {
+            if (state_[document_id] == ACTIVE) {
+                callback(document_id, scores_[document_id]);
+            }
+        }
+        UpdateMemoryUsage();
+    }
+
+    // Суммарная память всех существующих накопителей, включая накопители,
+    // которые потоки хранят между запросами
+    static size_t GetTotalMemoryUsage() {
+        return total_memory_usage_;
+    }
+
+private:
+    enum State : char {
+        EMPTY, ACTIVE, REMOVED
+    };
+
+    std::vector<double> scores_;
+    std::vector<State> state_;
+    std::vector<int> touched_;
+    size_t counted_bytes_ = 0;
+
+    inline static std::atomic<size_t> total_memory_usage_ { 0 };
+
+    void UpdateMemoryUsage() {
+        const size_t bytes = scores_.capacity() * sizeof(double)
+                + state_.capacity() * sizeof(State)
+                + touched_.capacity() * sizeof(int);
+        if (bytes != counted_bytes_) {
+            total_memory_usage_ += bytes;
+            total_memory_usage_ -= counted_bytes_;
+            counted_bytes_ = bytes;
+        }
+    }
+};
@@ -0,0 +1,64 @@
+/*
+ * search_cursor.cpp
+ *
+ *  Курсор кодируется шестнадцатеричной записью полей фиксированной длины.
+ */
+#include <stdexcept>
+#include "search_cursor.h"
+
+using namespace std;
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+const size_t CURSOR_BYTES = sizeof(uint64_t) * 2 + sizeof(int32_t) * 2;
+
+void AppendHex(string &out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes * 2; i-- > 0;) {
+        out.push_back(HEX_DIGITS[(value >> (i * 4)) & 0xF]);
+    }
+}
+
+uint64_t ReadHex(string_view &text, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes * 2; ++i) {
+        const char c = text[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else {
+            throw invalid_argument("Некорректный курсор."s);
+        }
+        value = (value << 4) | digit;
+    }
+    text.remove_prefix(bytes * 2);
+    return value;
+}
+
+}
+
+string EncodeSearchCursor(const SearchCursor &cursor) {
+    string result;
+    result.reserve(CURSOR_BYTES * 2);
+    AppendHex(result, cursor.generation, sizeof(uint64_t));
+    AppendHex(result, static_cast<uint64_t>(cursor.relevance_key),
+            sizeof(uint64_t));
+    AppendHex(result, static_cast<uint32_t>(cursor.rating), sizeof(int32_t));
+    AppendHex(result, static_cast<uint32_t>(cursor.id), sizeof(int32_t));
+    return result;
+}
+
+SearchCursor DecodeSearchCursor(string_view text) {
+    if (text.size() != CURSOR_BYTES * 2) {
+        throw invalid_argument("Некорректный курсор."s);
+    }
+    SearchCursor cursor;
+    cursor.generation = ReadHex(text, sizeof(uint64_t));
+    cursor.relevance_key = static_cast<int64_t>(ReadHex(text,
+            sizeof(uint64_t)));
+    cursor.rating = static_cast<int32_t>(ReadHex(text, sizeof(int32_t)));
+    cursor.id = static_cast<int32_t>(ReadHex(text, sizeof(int32_t)));
+    return cursor;
+}
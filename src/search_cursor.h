@@ -0,0 +1,74 @@
+#pragma once
+/*
+ * search_cursor.h
+ *
+ *  Курсор постраничной выдачи результатов поиска. Курсор хранит ключ
+ *  последнего выданного документа (округлённую релевантность, рейтинг,
+ *  идентификатор) и поколение индекса, на котором он получен. Для клиента
+ *  курсор — непрозрачная строка.
+ */
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+#include "ranking_policy.h"
+
+struct SearchCursor {
+    uint64_t generation = 0;
+    // релевантность в единицах EPSILON, как её сравнивает CursorOrdering
+    int64_t relevance_key = 0;
+    int rating = 0;
+    int id = 0;
+};
+
+std::string EncodeSearchCursor(const SearchCursor &cursor);
+// Выбрасывает invalid_argument, если строка не является курсором
+SearchCursor DecodeSearchCursor(std::string_view text);
+
+// Порядок выдачи для постраничного поиска: порядок политики ранжирования,
+// применённый к релевантности, округлённой до шага EPSILON, при равенстве —
+// по возрастанию идентификатора документа. Сравнение с допуском EPSILON
+// нетранзитивно, а округлённые значения либо равны, либо отличаются не
+// меньше чем на EPSILON, поэтому порядок строгий и курсор однозначно
+// делит выдачу на страницы
+template<typename RankingPolicy>
+struct CursorOrdering {
+    static int64_t GetRelevanceKey(double relevance) {
+        return std::llround(relevance / EPSILON);
+    }
+
+    static bool IsBetter(const Document &lhs, const Document &rhs) {
+        return IsBetterByKey(ToKeyDocument(lhs), ToKeyDocument(rhs));
+    }
+
+    // Документ идёт в выдаче после документа, на котором остановился курсор
+    static bool IsAfter(const Document &document, const SearchCursor &cursor) {
+        const Document cursor_key { cursor.id,
+                static_cast<double>(cursor.relevance_key), cursor.rating };
+        return IsBetterByKey(cursor_key, ToKeyDocument(document));
+    }
+
+private:
+    // Документ, релевантность которого заменена ключом. Ключи — целые
+    // числа, поэтому политика видит их равными только при точном равенстве
+    static Document ToKeyDocument(const Document &document) {
+        return {document.id,
+                static_cast<double>(GetRelevanceKey(document.relevance)),
+                document.rating};
+    }
+
+    static bool IsBetterByKey(const Document &lhs, const Document &rhs) {
+        if (RankingPolicy::IsBetter(lhs, rhs)) {
+            return true;
+        }
+        return !RankingPolicy::IsBetter(rhs, lhs) && lhs.id < rhs.id;
+    }
+};
+
+// Страница результатов; пустой next_cursor означает, что страниц больше нет
+struct SearchPage {
+    std::vector<Document> documents;
+    std::string next_cursor;
+};
@@ -5,6 +5,7 @@
  *      Author: vitasan
  */
 #include "search_server.h"
+#include "document_reordering.h"
 #include <vector>
 #include <string>
 #include <map>
@@ -14,6 +15,9 @@
 #include <cmath>
 #include <set>
 #include <stdexcept>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 using namespace std;
 
@@ -63,14 +67,94 @@ void SearchServer::AddDocument(int document_id, const string &document,
 
     const vector<string> words = SplitIntoWordsNoStop(document);
     int count_words = words.size();
+    const int internal_id = AddDocumentProperties(document_id, {
+            ComputeAverageRating(rating), status, count_words });
     double frequency_occurrence_word = 1. / count_words;
     for (const string &word : words) {
-        word_to_document_freqs_[word][document_id] += frequency_occurrence_word;
+        word_to_document_freqs_.AddPosting(word, internal_id,
+                frequency_occurrence_word);
     }
-    properties_documents_[document_id] =
-            { ComputeAverageRating(rating), status };
-    insert_doc_.push_back(document_id);
+    word_to_document_freqs_.FinishDocument();
+    total_word_count_ += count_words;
     ++document_count_;
+    ++generation_;
+}
+
+TokenizedDocument SearchServer::TokenizeDocument(int document_id,
+        string_view document, DocumentStatus status, vector<int> ratings) const {
+    if (document_id < 0)
+        throw invalid_argument(
+                "Идентификатор документа `"s + to_string(document_id)
+                        + "` меньше нуля."s);
+    if (document.empty())
+        throw invalid_argument(
+                "Документ с идентификатором `"s + to_string(document_id)
+                        + "` пустой."s);
+    TokenizedDocument result;
+    result.id = document_id;
+    result.status = status;
+    result.ratings = move(ratings);
+
+    vector<string_view> words;
+    while (!document.empty()) {
+        const size_t space = document.find(' ');
+        const string_view word = document.substr(0, space);
+        if (!word.empty()) {
+            if (!IsValidString(word)) {
+                throw invalid_argument(
+                        "Документ с идентификатором `"s + to_string(document_id)
+                                + "` содержит запрещенные символы."s);
+            }
+            if (!IsStopWord(word)) {
+                words.push_back(word);
+            }
+        }
+        document.remove_prefix(
+                space == string_view::npos ? document.size() : space + 1);
+    }
+    result.word_count = words.size();
+
+    sort(words.begin(), words.end());
+    for (const string_view word : words) {
+        if (!result.word_counts.empty()
+                && result.word_counts.back().first == word) {
+            ++result.word_counts.back().second;
+        } else {
+            result.word_counts.emplace_back(word, 1);
+        }
+    }
+    return result;
+}
+
+void SearchServer::AddDocument(const TokenizedDocument &document) {
+    CheckDocument(document);
+
+    const int internal_id = AddDocumentProperties(document.id, {
+            ComputeAverageRating(document.ratings), document.status,
+            document.word_count });
+    // документ только из стоп-слов не содержит слов индекса
+    const double inv_word_count =
+            document.word_count != 0 ? 1. / document.word_count : 0.;
+    for (const auto& [word, count] : document.word_counts) {
+        word_to_document_freqs_.AddPosting(word, internal_id,
+                count * inv_word_count);
+    }
+    word_to_document_freqs_.FinishDocument();
+    total_word_count_ += document.word_count;
+    ++document_count_;
+    ++generation_;
+}
+
+void SearchServer::CheckDocument(const TokenizedDocument &document) const {
+    if (document.id < 0)
+        throw invalid_argument(
+                "Идентификатор документа `"s + to_string(document.id)
+                        + "` меньше нуля."s);
+    if (external_to_internal_.count(document.id) != 0) {
+        throw invalid_argument(
+                "Идентификатор документа `"s + to_string(document.id)
+                        + "` уже был добавлен."s);
+    }
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string &raw_query) const {
@@ -80,51 +164,77 @@ vector<Document> SearchServer::FindTopDocuments(const string &raw_query) const {
 vector<Document> SearchServer::FindTopDocuments(const string &raw_query,
         DocumentStatus find_status) const {
     return FindTopDocuments(raw_query,
-            [&find_status](int document_id, DocumentStatus status, int rating) {
+            [&find_status](int, DocumentStatus status, int) {
                 return status == find_status;
             });
 }
 
-tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(
-        const string &raw_query, int document_id) const {
-    Query query;
+vector<Document> SearchServer::FindTopDocuments(const string &raw_query,
+        QueryStats &stats) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, stats);
+}
 
-    ParseQuery(raw_query, query);
-    CheckQurey(query);
+vector<Document> SearchServer::FindTopDocuments(const string &raw_query,
+        DocumentStatus find_status, QueryStats &stats) const {
+    return FindTopDocuments(raw_query,
+            [&find_status](int, DocumentStatus status, int) {
+                return status == find_status;
+            }, stats);
+}
 
-    vector<string> v_result;
-    DocumentStatus doc_stat = DocumentStatus::ACTUAL;
+SearchPage SearchServer::FindTopDocumentsPage(const string &raw_query,
+        size_t page_size, const string &cursor) const {
+    return FindTopDocumentsPage(raw_query,
+            [](int, DocumentStatus status, int) {
+                return status == DocumentStatus::ACTUAL;
+            }, page_size, cursor);
+}
 
-    auto interator = properties_documents_.find(document_id);
-    if (interator != properties_documents_.end()) {
-        doc_stat = interator->second.status; // @suppress("Field cannot be resolved")
-    }
+vector<Document> SearchServer::FindTopDocumentsExact(const string &raw_query,
+        DocumentStatus find_status) const {
+    return FindTopDocumentsExact(raw_query,
+            [find_status](int, DocumentStatus status, int) {
+                return status == find_status;
+            });
+}
 
-    if (query.minus_words.size() != 0) {
-        for (const string &minus_word : query.minus_words) {
-            auto map_word = word_to_document_freqs_.find(minus_word);
-            if (map_word != word_to_document_freqs_.end()) {
-                auto map_doc_id = map_word->second.find(document_id);
-                if (map_doc_id != map_word->second.end()) {
-                    return tuple(v_result, doc_stat);
-                }
+size_t SearchServer::EstimateQueryCost(const string &raw_query) const {
+    Query query;
+    ParseQuery(raw_query, query);
+    CheckQurey(query);
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+    // слова раскрываются так же, как при поиске, иначе слова из нескольких
+    // сегментов и повторы учитывались бы несколько раз
+    size_t cost = 0;
+    vector<PostingRange> ranges;
+    for (const auto &words : { ResolveQueryWords(index, query.plus_words),
+            ResolveQueryWords(index, query.minus_words) }) {
+        for (const string &word : words) {
+            ranges.clear();
+            index.GetPostings(word, ranges);
+            for (const PostingRange &range : ranges) {
+                cost += range.size();
             }
         }
     }
+    return cost;
+}
 
-    if (query.plus_words.size() != 0) {
-        for (const string &plus_word : query.plus_words) {
-            auto map_word = word_to_document_freqs_.find(plus_word);
-            if (map_word != word_to_document_freqs_.end()) {
-                auto map_doc_id = map_word->second.find(document_id);
-                if (map_doc_id != map_word->second.end()) {
-                    v_result.push_back(plus_word);
-                }
-            }
-        }
-    }
-    sort(v_result.begin(), v_result.end());
-    return tuple(v_result, doc_stat);
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(
+        const string &raw_query, int document_id) const {
+    NoQueryStats stats;
+    return MatchDocumentImpl(raw_query, document_id, stats);
+}
+
+tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(
+        const string &raw_query, int document_id, QueryStats &stats) const {
+    QueryStatsCollector collector(stats);
+    return MatchDocumentImpl(raw_query, document_id, collector);
 }
 
 int SearchServer::GetDocumentId(int index) const {
@@ -137,14 +247,143 @@ int SearchServer::GetDocumentId(int index) const {
     return insert_doc_.at(index);
 }
 
-SearchServer::DocumentProperties SearchServer::GetPropertiesDocument(
-        const int &id) const {
-    DocumentProperties doc_result;
-    const auto &interator = properties_documents_.find(id);
-    if (interator != properties_documents_.end()) {
-        return interator->second;
+vector<string> SearchServer::GetStopWords() const {
+    return stop_words_.GetWords();
+}
+
+IndexExport SearchServer::ExportIndex() const {
+    IndexExport result;
+    result.stop_words = GetStopWords();
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+    index.ForEachTermWithPrefix(""sv, [&result](string_view term) {
+        result.terms.emplace_back(term);
+    });
+    sort(result.terms.begin(), result.terms.end());
+    result.terms.erase(unique(result.terms.begin(), result.terms.end()),
+            result.terms.end());
+
+    vector<StoredDocument> documents(document_count_);
+    for (int internal_id = 0; internal_id < document_count_; ++internal_id) {
+        const DocumentProperties &properties =
+                properties_documents_[internal_id];
+        documents[internal_id] = { internal_to_external_[internal_id],
+                properties.status, properties.rating, properties.word_count, { } };
+    }
+    vector<PostingRange> ranges;
+    for (size_t term_id = 0; term_id < result.terms.size(); ++term_id) {
+        ranges.clear();
+        index.GetPostings(result.terms[term_id], ranges);
+        for (const PostingRange &range : ranges) {
+            for (const auto &element : range) {
+                StoredDocument &document = documents[element.first];
+                // индекс хранит долю вхождений слова среди слов документа
+                document.word_counts.emplace_back(term_id,
+                        static_cast<int>(llround(
+                                element.second * document.word_count)));
+            }
+        }
+    }
+    result.documents.reserve(document_count_);
+    for (const int document_id : insert_doc_) {
+        result.documents.push_back(
+                move(documents[external_to_internal_.at(document_id)]));
     }
-    return doc_result;
+    return result;
+}
+
+MemoryUsage SearchServer::GetMemoryUsage() const {
+    MemoryUsage result;
+    word_to_document_freqs_.AddMemoryUsage(result);
+    result.document_properties = GetHeapSize(properties_documents_)
+            + GetHeapSize(internal_to_external_)
+            + external_to_internal_.size()
+                    * GetTreeNodeSize<pair<const int, int>>();
+    result.document_ids = GetHeapSize(insert_doc_);
+    result.stop_words = stop_words_.GetMemoryUsage();
+    // накопители релевантности, которые потоки хранят между запросами;
+    // они общие для всех серверов процесса
+    result.caches = ScoreAccumulator::GetTotalMemoryUsage();
+    return result;
+}
+
+void SearchServer::Compact() {
+    word_to_document_freqs_.MergeAll();
+    insert_doc_.shrink_to_fit();
+    internal_to_external_.shrink_to_fit();
+    properties_documents_.shrink_to_fit();
+#ifdef __GLIBC__
+    // возвращаем освобождённую память системе, чтобы она ушла из RSS
+    malloc_trim(0);
+#endif
+}
+
+void SearchServer::ReorderDocuments() {
+    vector<vector<int>> document_terms =
+            word_to_document_freqs_.CollectDocumentTerms(document_count_);
+    int term_count = 0;
+    for (const vector<int> &terms : document_terms) {
+        for (const int term : terms) {
+            term_count = max(term_count, term + 1);
+        }
+    }
+    const vector<int> order = ComputeBisectionOrder(document_terms,
+            term_count);
+    document_terms.clear();
+
+    vector<int> new_ids(document_count_);
+    vector<int> internal_to_external(document_count_);
+    vector<DocumentProperties> properties(document_count_);
+    for (int new_id = 0; new_id < document_count_; ++new_id) {
+        const int old_id = order[new_id];
+        new_ids[old_id] = new_id;
+        internal_to_external[new_id] = internal_to_external_[old_id];
+        properties[new_id] = properties_documents_[old_id];
+        external_to_internal_[internal_to_external_[old_id]] = new_id;
+    }
+    internal_to_external_ = move(internal_to_external);
+    properties_documents_ = move(properties);
+
+    word_to_document_freqs_.Remap(new_ids);
+}
+
+double SearchServer::GetAveragePostingGapBits() const {
+    return word_to_document_freqs_.GetAveragePostingGapBits();
+}
+
+void SearchServer::SetSegmentBufferSize(int document_count) {
+    word_to_document_freqs_.SetBufferSize(document_count);
+}
+
+size_t SearchServer::GetSegmentCount() const {
+    return word_to_document_freqs_.GetSegmentCount();
+}
+
+void SearchServer::WaitForMerges() {
+    word_to_document_freqs_.WaitForMerges();
+}
+
+void SearchServer::SetFirstTierSize(size_t posting_count) {
+    word_to_document_freqs_.SetFirstTierSize(posting_count);
+}
+
+FirstTierStats SearchServer::GetFirstTierStats() const {
+    return { first_tier_queries_.value, first_tier_fallbacks_.value };
+}
+
+int SearchServer::GetInternalId(int document_id) const {
+    const auto it = external_to_internal_.find(document_id);
+    return it == external_to_internal_.end() ? -1 : it->second;
+}
+
+int SearchServer::AddDocumentProperties(int document_id,
+        const DocumentProperties &properties) {
+    const int internal_id = internal_to_external_.size();
+    external_to_internal_.emplace(document_id, internal_id);
+    internal_to_external_.push_back(document_id);
+    properties_documents_.push_back(properties);
+    insert_doc_.push_back(document_id);
+    return internal_id;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int> &ratings) {
@@ -156,29 +395,32 @@ int SearchServer::ComputeAverageRating(const vector<int> &ratings) {
     return sum / rating;
 }
 
-bool SearchServer::IsStopWord(const string &word) const {
-    if (stop_words_.size() != 0) {
-        return stop_words_.count(word) > 0;
-    }
-    return false;
+bool SearchServer::IsStopWord(string_view word) const {
+    return stop_words_.Contains(word);
 }
 
 vector<string> SearchServer::SplitIntoWordsNoStop(const string &text) const {
     vector<string> words;
-
-    for (const string &word : SplitIntoWords(text)) {
-        if (!IsValidString(word)) {
-            throw invalid_argument(
-                    "Текст `"s + text + "` содержит запрещенные символы."s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+    // стоп-слова отсеиваются в том же проходе, без копирования в строки
+    string_view rest = text;
+    while (!rest.empty()) {
+        const size_t space = rest.find(' ');
+        const string_view word = rest.substr(0, space);
+        if (!word.empty()) {
+            if (!IsValidString(word)) {
+                throw invalid_argument(
+                        "Текст `"s + text + "` содержит запрещенные символы."s);
+            }
+            if (!IsStopWord(word)) {
+                words.emplace_back(word);
+            }
         }
+        rest.remove_prefix(space == string_view::npos ? rest.size() : space + 1);
     }
     return words;
 }
 
-bool SearchServer::IsValidString(const string &str) {
+bool SearchServer::IsValidString(string_view str) {
     return none_of(str.begin(), str.end(), [](char c) {
         return c >= '\0' && c < ' ';
     });
@@ -189,8 +431,8 @@ void SearchServer::PossibleAddDocument(int document_id,
     if (document_id < 0) // id документа не может быть меньше нуля
         throw invalid_argument(
                 "Идентификатор документа `"s + document + "` меньше нуля."s);
-    auto result = find(insert_doc_.begin(), insert_doc_.end(), document_id);
-    if (result != end(insert_doc_)) { // проверка на добавленные идентификаторы документов
+    // проверка на добавленные идентификаторы документов
+    if (external_to_internal_.count(document_id) != 0) {
         throw invalid_argument(
                 "Идентификатор документа `"s + to_string(document_id)
                         + "` уже был добавлен."s);
@@ -224,9 +466,27 @@ void SearchServer::CheckQurey(Query &query) const {
     }
 }
 
-double SearchServer::CalcIDF(const string &word) const {
-    return log(
-            static_cast<double>(document_count_)
-                    / static_cast<double>(word_to_document_freqs_.at(word).size()));
+double SearchServer::GetAverageDocumentLength() const {
+    if (document_count_ == 0) {
+        return 0.;
+    }
+    return static_cast<double>(total_word_count_) / document_count_;
+}
+
+bool SearchServer::IsPrefixWord(const string &word) {
+    return word.size() > 1 && word.back() == '*';
+}
+
+void SearchServer::ResolveQueryWord(const SegmentedIndex::Snapshot &index,
+        const string &word, vector<string> &words) {
+    if (IsPrefixWord(word)) {
+        index.ForEachTermWithPrefix(
+                string_view(word).substr(0, word.size() - 1),
+                [&words](string_view term) {
+                    words.emplace_back(term);
+                });
+    } else {
+        words.push_back(word);
+    }
 }
 
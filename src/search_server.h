@@ -8,16 +8,73 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <map>
 #include <tuple>
 #include <algorithm>
+#include <atomic>
 #include <set>
+#include <type_traits>
 #include <stdexcept>
 #include "document.h"
+#include "query_stats.h"
+#include "segmented_index.h"
+#include "ranking_policy.h"
+#include "memory_usage.h"
+#include "score_accumulator.h"
+#include "search_cursor.h"
+#include "top_documents.h"
+#include "stop_word_filter.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+// Наибольший размер страницы постраничного поиска
+const size_t MAX_PAGE_SIZE = 10000;
 
-const double EPSILON = 1e-6;
+// Условие прерывания поиска по умолчанию: поиск всегда выполняется полностью
+struct NeverStop {
+    constexpr bool operator()() const {
+        return false;
+    }
+};
+
+// Счётчики поиска по первому уровню индекса
+struct FirstTierStats {
+    // Запросы, для которых использовался первый уровень
+    size_t queries = 0;
+    // Запросы, для которых не удалось доказать полноту результата
+    // по первому уровню и поиск выполнен по полным спискам
+    size_t fallbacks = 0;
+};
+
+// Документ, разобранный на слова без стоп-слов. Слова ссылаются на исходный
+// текст, который должен существовать до добавления документа в индекс.
+struct TokenizedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    // Уникальные слова документа и количество их вхождений
+    std::vector<std::pair<std::string_view, int>> word_counts;
+    int word_count = 0;
+};
+
+// Документ индекса с количеством вхождений слов; слова заданы номерами
+// в списке IndexExport::terms по возрастанию
+struct StoredDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+    int word_count = 0;
+    std::vector<std::pair<int, int>> word_counts;
+};
+
+struct IndexExport {
+    std::vector<std::string> stop_words;
+    // Все слова индекса в порядке возрастания
+    std::vector<std::string> terms;
+    // Документы в порядке добавления
+    std::vector<StoredDocument> documents;
+};
 
 class SearchServer {
 public:
@@ -26,6 +83,10 @@ public:
     template<typename Container>
     explicit SearchServer(const Container &container);
     explicit SearchServer(const std::string &text_stop_words);
+    // Стоп-слова, известные при компиляции: хеш-таблица уже построена
+    // компилятором и только копируется
+    template<size_t N>
+    explicit SearchServer(const StaticStopWordFilter<N> &stop_words);
 
     int GetDocumentCount() const;
 
@@ -34,7 +95,18 @@ public:
     void AddDocument(int document_id, const std::string &document,
             DocumentStatus status, const std::vector<int> &rating);
 
-    template<typename Filter>
+    // Разбор документа без изменения индекса; может выполняться параллельно
+    // с AddDocument из другого потока
+    TokenizedDocument TokenizeDocument(int document_id, std::string_view document,
+            DocumentStatus status, std::vector<int> ratings) const;
+
+    void AddDocument(const TokenizedDocument &document);
+    // Выбрасывает invalid_argument, если AddDocument отклонит документ
+    void CheckDocument(const TokenizedDocument &document) const;
+
+    // Политика ранжирования задаётся первым параметром шаблона, например
+    // FindTopDocuments<Bm25Ranking>(raw_query, filter_fun)
+    template<typename RankingPolicy = TfIdfRanking, typename Filter>
     std::vector<Document> FindTopDocuments(const std::string &raw_query,
             Filter filter_fun) const;
 
@@ -43,16 +115,139 @@ public:
     std::vector<Document> FindTopDocuments(const std::string &raw_query,
             DocumentStatus find_status) const;
 
+    template<typename RankingPolicy>
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            DocumentStatus find_status = DocumentStatus::ACTUAL) const;
+
+    // Варианты поиска со сбором статистики выполнения запроса
+    template<typename RankingPolicy = TfIdfRanking, typename Filter>
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            Filter filter_fun, QueryStats &stats) const;
+
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            QueryStats &stats) const;
+
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            DocumentStatus find_status, QueryStats &stats) const;
+
+    // Поиск с прерыванием: should_stop() проверяется перед обработкой каждого
+    // списка документов плюс-слова. Если поиск прерван, возвращается лучший
+    // результат по уже обработанным словам и truncated = true
+    template<typename RankingPolicy = TfIdfRanking, typename Filter,
+            typename StopCondition>
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            Filter filter_fun, StopCondition should_stop,
+            bool &truncated) const;
+    template<typename RankingPolicy = TfIdfRanking, typename Filter,
+            typename StopCondition>
+    std::vector<Document> FindTopDocuments(const std::string &raw_query,
+            Filter filter_fun, StopCondition should_stop, bool &truncated,
+            QueryStats &stats) const;
+
+    // Постраничный поиск: возвращает page_size лучших документов, идущих
+    // после документа, на котором остановился cursor (пустой курсор —
+    // первая страница). Документы с равной релевантностью и рейтингом
+    // упорядочиваются по идентификатору. Курсор действителен, пока в индекс
+    // не добавлены новые документы. page_size — от 1 до MAX_PAGE_SIZE.
+    template<typename RankingPolicy = TfIdfRanking, typename Filter>
+    SearchPage FindTopDocumentsPage(const std::string &raw_query,
+            Filter filter_fun, size_t page_size,
+            const std::string &cursor = std::string()) const;
+
+    SearchPage FindTopDocumentsPage(const std::string &raw_query,
+            size_t page_size, const std::string &cursor = std::string()) const;
+
+    // Пакетный поиск: запросы пакета группируются по словам, и список
+    // документов каждого слова просматривается один раз для всех запросов
+    // группы. Результат каждого запроса совпадает с FindTopDocuments.
+    template<typename RankingPolicy = TfIdfRanking>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+            const std::vector<std::string> &raw_queries,
+            DocumentStatus find_status = DocumentStatus::ACTUAL) const;
+
+    // Статус или фильтр задаётся для каждого запроса отдельно; размер
+    // statuses и filters должен совпадать с числом запросов
+    template<typename RankingPolicy = TfIdfRanking>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+            const std::vector<std::string> &raw_queries,
+            const std::vector<DocumentStatus> &statuses) const;
+
+    template<typename RankingPolicy = TfIdfRanking, typename Filter>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(
+            const std::vector<std::string> &raw_queries,
+            const std::vector<Filter> &filters) const;
+
+    // Поколение индекса, увеличивается при каждом добавлении документа
+    uint64_t GetGeneration() const;
+
+    // Оценка стоимости запроса: суммарная длина списков документов его слов
+    size_t EstimateQueryCost(const std::string &raw_query) const;
+
+    // Поиск по полным спискам документов без использования первого уровня
+    template<typename RankingPolicy = TfIdfRanking, typename Filter>
+    std::vector<Document> FindTopDocumentsExact(const std::string &raw_query,
+            Filter filter_fun) const;
+
+    std::vector<Document> FindTopDocumentsExact(const std::string &raw_query,
+            DocumentStatus find_status = DocumentStatus::ACTUAL) const;
+
     std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(
             const std::string &raw_query, int document_id) const;
 
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(
+            const std::string &raw_query, int document_id,
+            QueryStats &stats) const;
+
     int GetDocumentId(int index) const;
 
+    std::vector<std::string> GetStopWords() const;
+    // Содержимое индекса для сохранения снимка. Добавление документов
+    // из IndexExport через AddDocument(TokenizedDocument) восстанавливает
+    // индекс с теми же результатами поиска
+    IndexExport ExportIndex() const;
+
+    // Память, занятая индексом, с разбивкой по структурам
+    MemoryUsage GetMemoryUsage() const;
+    // Перестраивает словарь и списки документов, освобождая неиспользуемую
+    // после добавления документов память
+    void Compact();
+
+    // Перенумеровывает внутренние идентификаторы документов рекурсивным
+    // разбиением графа документ-слово так, чтобы документы с общими словами
+    // оказались рядом. Результаты поиска и GetDocumentId не меняются:
+    // документы с равной релевантностью и рейтингом упорядочиваются
+    // по внешнему идентификатору.
+    void ReorderDocuments();
+    // Средний log2 разности соседних идентификаторов в списках документов —
+    // оценка числа бит на запись при разностном кодировании
+    double GetAveragePostingGapBits() const;
+
+    // Количество документов в буфере индекса, после которого буфер
+    // превращается в неизменяемый сегмент
+    void SetSegmentBufferSize(int document_count);
+    size_t GetSegmentCount() const;
+    // Ожидает завершения фоновых слияний сегментов
+    void WaitForMerges();
+
+    // Включает первый уровень индекса: для каждого слова отдельно хранятся
+    // posting_count записей с наибольшей частотой. FindTopDocuments сначала
+    // ищет по первому уровню и обращается к полным спискам, только если не
+    // может доказать, что найденные документы — лучшие. 0 выключает первый
+    // уровень. Уже добавленные документы перестраиваются при Compact
+    void SetFirstTierSize(size_t posting_count);
+    FirstTierStats GetFirstTierStats() const;
+
 private:
 
+    // Запросов в группе пакетного поиска; на каждый запрос группы
+    // приходится свой накопитель размером с число документов
+    static constexpr size_t MAX_BATCH_GROUP_SIZE = 16;
+
     struct DocumentProperties {
         int rating;
         DocumentStatus status;
+        // Количество слов документа без стоп-слов
+        int word_count;
     };
 
     struct Query {
@@ -60,93 +255,657 @@ private:
         std::vector<std::string> minus_words;
     };
 
+    // Внешние идентификаторы документов в порядке добавления
     std::vector<int> insert_doc_;
-    std::map<int, DocumentProperties> properties_documents_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
+    // Все внутренние структуры используют плотные внутренние идентификаторы
+    // документов 0..document_count_-1
+    std::map<int, int> external_to_internal_;
+    std::vector<int> internal_to_external_;
+    std::vector<DocumentProperties> properties_documents_;
+    // Частоты слов в документах
+    SegmentedIndex word_to_document_freqs_;
     int document_count_ = 0;
-    std::set<std::string> stop_words_;
+    long long total_word_count_ = 0;
+    uint64_t generation_ = 0;
+    // Атомарный счётчик, который копируется вместе с сервером
+    struct Counter {
+        std::atomic<size_t> value { 0 };
 
-    DocumentProperties GetPropertiesDocument(const int &id) const;
+        Counter() = default;
+        Counter(const Counter &other) :
+                value(other.value.load()) {
+        }
+        Counter& operator=(const Counter &other) {
+            value = other.value.load();
+            return *this;
+        }
+    };
+    mutable Counter first_tier_queries_;
+    mutable Counter first_tier_fallbacks_;
+    StopWordFilter stop_words_;
+
+    // Внутренний идентификатор документа или -1
+    int GetInternalId(int document_id) const;
+    int AddDocumentProperties(int document_id,
+            const DocumentProperties &properties);
 
     static int ComputeAverageRating(const std::vector<int> &ratings);
-    bool IsStopWord(const std::string &word) const;
+    bool IsStopWord(std::string_view word) const;
     std::vector<std::string> SplitIntoWordsNoStop(
             const std::string &text) const;
-    static bool IsValidString(const std::string &str);
+    static bool IsValidString(std::string_view str);
     void PossibleAddDocument(int document_id,
             const std::string &document) const;
     void ParseQuery(const std::string &text, Query &query) const;
     void CheckQurey(Query &query) const;
-    double CalcIDF(const std::string &word) const;
+    double GetAverageDocumentLength() const;
+    // Слово запроса с '*' на конце раскрывается во все слова с этим префиксом
+    static bool IsPrefixWord(const std::string &word);
+    static void ResolveQueryWord(const SegmentedIndex::Snapshot &index,
+            const std::string &word, std::vector<std::string> &words);
+    // Раскрывает слова запроса без повторов: слово из нескольких сегментов
+    // и совпадения разных префиксов просматриваются один раз
+    template<typename Words>
+    static std::vector<std::string> ResolveQueryWords(
+            const SegmentedIndex::Snapshot &index, const Words &words);
+
+    template<typename RankingPolicy, typename Filter, typename StatsCollector,
+            typename StopCondition = NeverStop>
+    std::vector<Document> FindTopDocumentsImpl(const std::string &raw_query,
+            Filter filter_fun, StatsCollector &stats, StopCondition should_stop =
+                    NeverStop(), bool *truncated = nullptr,
+            bool exact = false) const;
 
-    template<typename FilterFun>
-    std::vector<Document> FindAllDocuments(const Query &query,
-            FilterFun lambda_func) const;
+    // Поиск по первому уровню. Возвращает false, если полноту результата
+    // доказать не удалось
+    template<typename RankingPolicy, typename Filter, typename StatsCollector>
+    bool FindTopDocumentsFromFirstTier(const Query &query, Filter filter_fun,
+            StatsCollector &stats, std::vector<Document> &result) const;
+
+    // query_filter(query_index, document_id, status, rating) отбирает
+    // документы запроса с номером query_index
+    template<typename RankingPolicy, typename QueryFilter>
+    std::vector<std::vector<Document>> FindTopDocumentsBatchImpl(
+            const std::vector<std::string> &raw_queries,
+            QueryFilter query_filter) const;
+
+    // Добавляет слова запроса query_index в таблицу слово -> запросы группы
+    template<typename Words>
+    static void AddBatchTerms(const SegmentedIndex::Snapshot &index,
+            const Words &words, int query_index,
+            std::map<std::string, std::vector<int>> &term_queries);
+
+    // Передаёт каждый прошедший фильтр документ в consume_document
+    template<typename RankingPolicy, typename FilterFun,
+            typename StatsCollector, typename StopCondition,
+            typename DocumentConsumer>
+    void FindAllDocuments(const Query &query, FilterFun lambda_func,
+            StatsCollector &stats, StopCondition &should_stop, bool *truncated,
+            DocumentConsumer consume_document) const;
+
+    template<typename StatsCollector>
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocumentImpl(
+            const std::string &raw_query, int document_id,
+            StatsCollector &stats) const;
 };
 
-template<typename Filter>
+template<typename RankingPolicy, typename Filter>
 std::vector<Document> SearchServer::FindTopDocuments(
         const std::string &raw_query, Filter filter_fun) const {
+    NoQueryStats stats;
+    return FindTopDocumentsImpl<RankingPolicy>(raw_query, filter_fun, stats);
+}
+
+template<typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::string &raw_query, DocumentStatus find_status) const {
+    return FindTopDocuments<RankingPolicy>(raw_query,
+            [find_status](int, DocumentStatus status, int) {
+                return status == find_status;
+            });
+}
+
+template<typename RankingPolicy, typename Filter>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::string &raw_query, Filter filter_fun,
+        QueryStats &stats) const {
+    QueryStatsCollector collector(stats);
+    return FindTopDocumentsImpl<RankingPolicy>(raw_query, filter_fun,
+            collector);
+}
+
+template<typename RankingPolicy, typename Filter>
+std::vector<Document> SearchServer::FindTopDocumentsExact(
+        const std::string &raw_query, Filter filter_fun) const {
+    NoQueryStats stats;
+    return FindTopDocumentsImpl<RankingPolicy>(raw_query, filter_fun, stats,
+            NeverStop(), nullptr, true);
+}
+
+template<typename RankingPolicy, typename Filter, typename StopCondition>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::string &raw_query, Filter filter_fun,
+        StopCondition should_stop, bool &truncated) const {
+    NoQueryStats stats;
+    truncated = false;
+    return FindTopDocumentsImpl<RankingPolicy>(raw_query, filter_fun, stats,
+            should_stop, &truncated);
+}
+
+template<typename RankingPolicy, typename Filter, typename StopCondition>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::string &raw_query, Filter filter_fun,
+        StopCondition should_stop, bool &truncated, QueryStats &stats) const {
+    QueryStatsCollector collector(stats);
+    truncated = false;
+    return FindTopDocumentsImpl<RankingPolicy>(raw_query, filter_fun,
+            collector, should_stop, &truncated);
+}
+
+template<typename RankingPolicy, typename Filter, typename StatsCollector,
+        typename StopCondition>
+std::vector<Document> SearchServer::FindTopDocumentsImpl(
+        const std::string &raw_query, Filter filter_fun, StatsCollector &stats,
+        StopCondition should_stop, bool *truncated, bool exact) const {
     std::vector<Document> result;
-    std::set<std::string> query_words;
     Query query;
-    ParseQuery(raw_query, query);
-    CheckQurey(query);
-    result = FindAllDocuments(query, filter_fun);
-
-    auto by_relevance = [](const Document &lhs, const Document &rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
+    {
+        StageTimer timer(stats, QueryStage::PARSE);
+        ParseQuery(raw_query, query);
+        CheckQurey(query);
+    }
+    // прерываемый поиск всегда выполняется по полным спискам
+    if constexpr (std::is_same_v<StopCondition, NeverStop>) {
+        if (!exact && word_to_document_freqs_.GetFirstTierSize() > 0) {
+            ++first_tier_queries_.value;
+            if (FindTopDocumentsFromFirstTier<RankingPolicy>(query, filter_fun,
+                    stats, result)) {
+                return result;
+            }
+            ++first_tier_fallbacks_.value;
+            result.clear();
         }
-        return lhs.relevance > rhs.relevance;
-    };
+    }
+    FindAllDocuments<RankingPolicy>(query, filter_fun, stats, should_stop,
+            truncated, [&result](const Document &document) {
+                result.push_back(document);
+            });
 
-    std::sort(result.begin(), result.end(), by_relevance);
+    StageTimer timer(stats, QueryStage::RANK);
+    std::sort(result.begin(), result.end(),
+            IdTieBreakOrdering<RankingPolicy>::IsBetter);
     if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
         result.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
     return result;
 }
 
-template<typename FilterFun>
-std::vector<Document> SearchServer::FindAllDocuments(const Query &query,
-        FilterFun lambda_func) const {
-    std::vector<Document> matched_documents;
-    std::map<int, double> query_result;
+// Оценка каждого документа первого уровня вычисляется точно по полным
+// спискам. Документ, не попавший в первый уровень ни одного слова, получает
+// не больше суммы верхних границ оценок слов вне первого уровня. Если
+// MAX_RESULT_DOCUMENT_COUNT-й найденный документ оценён выше этой суммы,
+// результат полон.
+template<typename RankingPolicy, typename Filter, typename StatsCollector>
+bool SearchServer::FindTopDocumentsFromFirstTier(const Query &query,
+        Filter filter_fun, StatsCollector &stats,
+        std::vector<Document> &result) const {
+    StageTimer timer(stats, QueryStage::SCORE);
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+    const std::vector<std::string> plus_words = ResolveQueryWords(index,
+            query.plus_words);
+    const std::vector<std::string> minus_words = ResolveQueryWords(index,
+            query.minus_words);
 
-    if (query.plus_words.size() != 0) {
-        for (const std::string &plus_word : query.plus_words) {
-            const auto &temp_map = word_to_document_freqs_.find(plus_word);
-            if (temp_map != word_to_document_freqs_.end()) {
-                const std::map<int, double> &temp_set = temp_map->second;
-                double idf = CalcIDF(plus_word);
-                for (auto &element : temp_set) {
-                    double &rel = query_result[element.first];
-                    rel = rel + idf * element.second;
+    double average_document_length = 0.;
+    if constexpr (RankingPolicy::uses_document_length) {
+        average_document_length = GetAverageDocumentLength();
+    }
+    struct TermPostings {
+        std::vector<PostingRange> ranges;
+        double idf;
+    };
+    std::vector<TermPostings> terms;
+    std::vector<int> candidates;
+    std::vector<PostingRange> tier;
+    double unseen_bound = 0.;
+    bool has_rest = false;
+    for (const std::string &plus_word : plus_words) {
+        TermPostings term;
+        index.GetPostings(plus_word, term.ranges);
+        size_t document_freq = 0;
+        for (const PostingRange &range : term.ranges) {
+            document_freq += range.size();
+        }
+        if (document_freq == 0) {
+            continue;
+        }
+        stats.AddTermsResolved(1);
+        term.idf = RankingPolicy::ComputeIdf(document_count_, document_freq);
+        tier.clear();
+        const double rest_max_tf = index.GetFirstTier(plus_word, tier);
+        if (rest_max_tf > 0.) {
+            has_rest = true;
+            unseen_bound += RankingPolicy::ComputeScoreBound(rest_max_tf,
+                    term.idf, average_document_length);
+        }
+        for (const PostingRange &range : tier) {
+            stats.AddPostingsScanned(range.size());
+            for (const Posting &posting : range) {
+                candidates.push_back(posting.first);
+            }
+        }
+        terms.push_back(std::move(term));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+            candidates.end());
+    stats.AddCandidates(candidates.size());
+
+    std::vector<PostingRange> minus_ranges;
+    for (const std::string &minus_word : minus_words) {
+        stats.AddTermsResolved(1);
+        index.GetPostings(minus_word, minus_ranges);
+    }
+    for (const int internal_id : candidates) {
+        const bool excluded = std::any_of(minus_ranges.begin(),
+                minus_ranges.end(), [internal_id](const PostingRange &range) {
+                    return range.ContainsDocument(internal_id);
+                });
+        if (excluded) {
+            stats.AddMinusEliminated(1);
+            continue;
+        }
+        const DocumentProperties &doc_prop = properties_documents_[internal_id];
+        const int document_id = internal_to_external_[internal_id];
+        if (!filter_fun(document_id, doc_prop.status, doc_prop.rating)) {
+            stats.AddFilterRejected(1);
+            continue;
+        }
+        // слова складываются в том же порядке, что и в FindAllDocuments
+        double relevance = 0.;
+        for (const TermPostings &term : terms) {
+            for (const PostingRange &range : term.ranges) {
+                if (const Posting *posting = range.Find(internal_id)) {
+                    relevance += RankingPolicy::ComputeScore(posting->second,
+                            term.idf, doc_prop.word_count,
+                            average_document_length);
+                    break;
                 }
             }
         }
-        if (query.minus_words.size() != 0) {
-            for (const std::string &minus_word : query.minus_words) {
-                const auto &temp_map = word_to_document_freqs_.find(minus_word);
-                if (temp_map != word_to_document_freqs_.end()) {
-                    const std::map<int, double> &temp_set = temp_map->second;
+        result.push_back( { document_id, relevance, doc_prop.rating });
+    }
+
+    std::sort(result.begin(), result.end(),
+            IdTieBreakOrdering<RankingPolicy>::IsBetter);
+    // без записей вне первого уровня он совпадает с полными списками
+    const bool complete = !has_rest
+            || (result.size() >= MAX_RESULT_DOCUMENT_COUNT
+                    && result[MAX_RESULT_DOCUMENT_COUNT - 1].relevance
+                            - unseen_bound >= EPSILON);
+    if (!complete) {
+        return false;
+    }
+    if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        result.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return true;
+}
+
+template<typename RankingPolicy, typename Filter>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string &raw_query,
+        Filter filter_fun, size_t page_size, const std::string &cursor) const {
+    using std::operator""s;
+    if (page_size == 0) {
+        throw std::invalid_argument("Размер страницы должен быть больше нуля."s);
+    }
+    if (page_size > MAX_PAGE_SIZE) {
+        throw std::invalid_argument(
+                "Размер страницы не должен превышать "s
+                        + std::to_string(MAX_PAGE_SIZE) + "."s);
+    }
+    using Ordering = CursorOrdering<RankingPolicy>;
+    SearchCursor after;
+    const bool has_cursor = !cursor.empty();
+    if (has_cursor) {
+        after = DecodeSearchCursor(cursor);
+        if (after.generation != generation_) {
+            throw std::invalid_argument(
+                    "Курсор получен до изменения индекса."s);
+        }
+    }
+    Query query;
+    ParseQuery(raw_query, query);
+    CheckQurey(query);
+
+    NoQueryStats stats;
+    NeverStop should_stop;
+    TopDocuments<Ordering> top(page_size);
+    FindAllDocuments<RankingPolicy>(query, filter_fun, stats, should_stop,
+            nullptr, [&](const Document &document) {
+                if (!has_cursor || Ordering::IsAfter(document, after)) {
+                    top.Add(document);
+                }
+            });
+
+    SearchPage page;
+    page.documents = top.Extract();
+    if (page.documents.size() == page_size) {
+        const Document &last = page.documents.back();
+        page.next_cursor = EncodeSearchCursor( { generation_,
+                Ordering::GetRelevanceKey(last.relevance), last.rating,
+                last.id });
+    }
+    return page;
+}
+
+template<typename RankingPolicy>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(
+        const std::vector<std::string> &raw_queries,
+        DocumentStatus find_status) const {
+    return FindTopDocumentsBatchImpl<RankingPolicy>(raw_queries,
+            [find_status](size_t, int, DocumentStatus status, int) {
+                return status == find_status;
+            });
+}
+
+template<typename RankingPolicy>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(
+        const std::vector<std::string> &raw_queries,
+        const std::vector<DocumentStatus> &statuses) const {
+    using std::operator""s;
+    if (statuses.size() != raw_queries.size()) {
+        throw std::invalid_argument(
+                "Число статусов не совпадает с числом запросов."s);
+    }
+    return FindTopDocumentsBatchImpl<RankingPolicy>(raw_queries,
+            [&statuses](size_t query_index, int, DocumentStatus status, int) {
+                return status == statuses[query_index];
+            });
+}
+
+template<typename RankingPolicy, typename Filter>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(
+        const std::vector<std::string> &raw_queries,
+        const std::vector<Filter> &filters) const {
+    using std::operator""s;
+    if (filters.size() != raw_queries.size()) {
+        throw std::invalid_argument(
+                "Число фильтров не совпадает с числом запросов."s);
+    }
+    return FindTopDocumentsBatchImpl<RankingPolicy>(raw_queries,
+            [&filters](size_t query_index, int document_id,
+                    DocumentStatus status, int rating) {
+                return filters[query_index](document_id, status, rating);
+            });
+}
+
+template<typename RankingPolicy, typename QueryFilter>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatchImpl(
+        const std::vector<std::string> &raw_queries,
+        QueryFilter query_filter) const {
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    // накопители группы живут только на время вызова, чтобы потоки
+    // не хранили между пакетами по MAX_BATCH_GROUP_SIZE массивов размером
+    // с индекс
+    std::vector<ScoreAccumulator> accumulators(
+            std::min(MAX_BATCH_GROUP_SIZE, raw_queries.size()));
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+    double average_document_length = 0.;
+    if constexpr (RankingPolicy::uses_document_length) {
+        average_document_length = GetAverageDocumentLength();
+    }
+    std::vector<PostingRange> ranges;
+    for (size_t group_begin = 0; group_begin < raw_queries.size();
+            group_begin += MAX_BATCH_GROUP_SIZE) {
+        const size_t group_size = std::min(MAX_BATCH_GROUP_SIZE,
+                raw_queries.size() - group_begin);
+        std::map<std::string, std::vector<int>> plus_terms;
+        std::map<std::string, std::vector<int>> minus_terms;
+        for (size_t i = 0; i < group_size; ++i) {
+            Query query;
+            ParseQuery(raw_queries[group_begin + i], query);
+            CheckQurey(query);
+            accumulators[i].Reset(document_count_);
+            AddBatchTerms(index, query.plus_words, i, plus_terms);
+            AddBatchTerms(index, query.minus_words, i, minus_terms);
+        }
+
+        // Слова перебираются в том же порядке, что и в FindAllDocuments,
+        // поэтому релевантность суммируется в том же порядке
+        for (const auto &[term, query_indexes] : plus_terms) {
+            ranges.clear();
+            index.GetPostings(term, ranges);
+            size_t document_freq = 0;
+            for (const PostingRange &range : ranges) {
+                document_freq += range.size();
+            }
+            if (document_freq == 0) {
+                continue;
+            }
+            const double idf = RankingPolicy::ComputeIdf(document_count_,
+                    document_freq);
+            for (const PostingRange &range : ranges) {
+                for (const auto &element : range) {
+                    int document_length = 0;
+                    if constexpr (RankingPolicy::uses_document_length) {
+                        document_length =
+                                properties_documents_[element.first].word_count;
+                    }
+                    const double score = RankingPolicy::ComputeScore(
+                            element.second, idf, document_length,
+                            average_document_length);
+                    for (const int query_index : query_indexes) {
+                        accumulators[query_index].Add(element.first, score);
+                    }
+                }
+            }
+        }
+        for (const auto &[term, query_indexes] : minus_terms) {
+            ranges.clear();
+            index.GetPostings(term, ranges);
+            for (const PostingRange &range : ranges) {
+                for (const auto &element : range) {
+                    for (const int query_index : query_indexes) {
+                        accumulators[query_index].Remove(element.first);
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < group_size; ++i) {
+            std::vector<Document> &result = results[group_begin + i];
+            accumulators[i].ForEach([&](int internal_id, double relevance) {
+                const DocumentProperties &doc_prop =
+                        properties_documents_[internal_id];
+                const int document_id = internal_to_external_[internal_id];
+                if (query_filter(group_begin + i, document_id, doc_prop.status,
+                        doc_prop.rating)) {
+                    result.push_back( { document_id, relevance,
+                            doc_prop.rating });
+                }
+            });
+            std::sort(result.begin(), result.end(),
+            IdTieBreakOrdering<RankingPolicy>::IsBetter);
+            if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
+                result.resize(MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+    }
+    return results;
+}
+
+template<typename Words>
+std::vector<std::string> SearchServer::ResolveQueryWords(
+        const SegmentedIndex::Snapshot &index, const Words &words) {
+    std::vector<std::string> result;
+    for (const std::string &word : words) {
+        ResolveQueryWord(index, word, result);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+template<typename Words>
+void SearchServer::AddBatchTerms(const SegmentedIndex::Snapshot &index,
+        const Words &words, int query_index,
+        std::map<std::string, std::vector<int>> &term_queries) {
+    std::vector<std::string> terms;
+    for (const std::string &word : words) {
+        ResolveQueryWord(index, word, terms);
+    }
+    for (std::string &term : terms) {
+        std::vector<int> &query_indexes = term_queries[std::move(term)];
+        // слово может встретиться в запросе повторно через префикс
+        if (query_indexes.empty() || query_indexes.back() != query_index) {
+            query_indexes.push_back(query_index);
+        }
+    }
+}
+
+template<typename RankingPolicy, typename FilterFun, typename StatsCollector,
+        typename StopCondition, typename DocumentConsumer>
+void SearchServer::FindAllDocuments(const Query &query, FilterFun lambda_func,
+        StatsCollector &stats, StopCondition &should_stop, bool *truncated,
+        DocumentConsumer consume_document) const {
+    static thread_local ScoreAccumulator query_result;
+    query_result.Reset(document_count_);
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+
+    if (query.plus_words.size() != 0) {
+        {
+            StageTimer timer(stats, QueryStage::SCORE);
+            const std::vector<std::string> plus_words = ResolveQueryWords(
+                    index, query.plus_words);
+            double average_document_length = 0.;
+            if constexpr (RankingPolicy::uses_document_length) {
+                average_document_length = GetAverageDocumentLength();
+            }
+            // Списки слова из всех сегментов; IDF считается по всему индексу
+            std::vector<PostingRange> ranges;
+            for (const std::string &plus_word : plus_words) {
+                if (should_stop()) {
+                    *truncated = true;
+                    break;
+                }
+                ranges.clear();
+                index.GetPostings(plus_word, ranges);
+                size_t document_freq = 0;
+                for (const PostingRange &range : ranges) {
+                    document_freq += range.size();
+                }
+                if (document_freq == 0) {
+                    continue;
+                }
+                stats.AddTermsResolved(1);
+                stats.AddPostingsScanned(document_freq);
+                double idf = RankingPolicy::ComputeIdf(document_count_,
+                        document_freq);
+                for (const PostingRange &temp_set : ranges) {
                     for (auto &element : temp_set) {
-                        query_result.erase(element.first);
+                        int document_length = 0;
+                        if constexpr (RankingPolicy::uses_document_length) {
+                            document_length =
+                                    properties_documents_[element.first].word_count;
+                        }
+                        query_result.Add(element.first,
+                                RankingPolicy::ComputeScore(element.second,
+                                        idf, document_length,
+                                        average_document_length));
+                    }
+                }
+            }
+            stats.AddCandidates(query_result.GetCandidateCount());
+            if (query.minus_words.size() != 0) {
+                const std::vector<std::string> minus_words =
+                        ResolveQueryWords(index, query.minus_words);
+                for (const std::string &minus_word : minus_words) {
+                    ranges.clear();
+                    index.GetPostings(minus_word, ranges);
+                    stats.AddTermsResolved(1);
+                    for (const PostingRange &temp_set : ranges) {
+                        stats.AddPostingsScanned(temp_set.size());
+                        for (auto &element : temp_set) {
+                            stats.AddMinusEliminated(
+                                    query_result.Remove(element.first));
+                        }
                     }
                 }
             }
         }
-        for (auto &res : query_result) {
-            SearchServer::DocumentProperties doc_prop = GetPropertiesDocument(
-                    res.first);
-            if (lambda_func(res.first, doc_prop.status, doc_prop.rating)) {
-                matched_documents.push_back( // @suppress("Invalid arguments")
-                        { res.first, res.second, doc_prop.rating });
+        StageTimer timer(stats, QueryStage::FILTER);
+        query_result.ForEach([&](int internal_id, double relevance) {
+            const DocumentProperties &doc_prop =
+                    properties_documents_[internal_id];
+            const int document_id = internal_to_external_[internal_id];
+            if (lambda_func(document_id, doc_prop.status, doc_prop.rating)) {
+                consume_document( { document_id, relevance, doc_prop.rating });
+            } else {
+                stats.AddFilterRejected(1);
+            }
+        });
+    }
+}
+
+template<typename StatsCollector>
+std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocumentImpl(
+        const std::string &raw_query, int document_id,
+        StatsCollector &stats) const {
+    Query query;
+    {
+        StageTimer timer(stats, QueryStage::PARSE);
+        ParseQuery(raw_query, query);
+        CheckQurey(query);
+    }
+
+    StageTimer timer(stats, QueryStage::SCORE);
+    std::vector<std::string> v_result;
+    DocumentStatus doc_stat = DocumentStatus::ACTUAL;
+
+    const int internal_id = GetInternalId(document_id);
+    if (internal_id >= 0) {
+        doc_stat = properties_documents_[internal_id].status;
+    }
+
+    const SegmentedIndex::Snapshot index =
+            word_to_document_freqs_.GetSnapshot();
+    if (query.minus_words.size() != 0) {
+        std::vector<std::string> minus_words;
+        for (const std::string &minus_word : query.minus_words) {
+            ResolveQueryWord(index, minus_word, minus_words);
+        }
+        for (const std::string &minus_word : minus_words) {
+            stats.AddTermsResolved(1);
+            stats.AddPostingsScanned(1);
+            if (index.ContainsDocument(minus_word, internal_id)) {
+                stats.AddMinusEliminated(1);
+                return std::tuple(v_result, doc_stat);
+            }
+        }
+    }
+
+    if (query.plus_words.size() != 0) {
+        // для слова с префиксом возвращаются найденные в документе слова
+        std::vector<std::string> plus_words;
+        for (const std::string &plus_word : query.plus_words) {
+            ResolveQueryWord(index, plus_word, plus_words);
+        }
+        for (const std::string &plus_word : plus_words) {
+            stats.AddTermsResolved(1);
+            stats.AddPostingsScanned(1);
+            if (index.ContainsDocument(plus_word, internal_id)) {
+                v_result.push_back(plus_word);
             }
         }
     }
-    return matched_documents;
+    std::sort(v_result.begin(), v_result.end());
+    v_result.erase(std::unique(v_result.begin(), v_result.end()),
+            v_result.end());
+    return std::tuple(v_result, doc_stat);
 }
 
 template<typename Container>
@@ -157,14 +916,20 @@ SearchServer::SearchServer(const Container &container) {
         if (!IsValidString(word)) {
             throw std::invalid_argument(
                     "Слово `" + word + "` имеет запрещенные символы.");
-            std::vector<std::string> words;
         }
+    }
+    // пустые слова и повторы отбрасываются при построении
+    stop_words_ = StopWordFilter(container);
+}
 
-        const auto &result = find(begin(stop_words_), end(stop_words_), word);
-        if (result == stop_words_.end())
-            if (!word.empty()) {
-                stop_words_.insert(word);
-            }
+template<size_t N>
+SearchServer::SearchServer(const StaticStopWordFilter<N> &stop_words) :
+        stop_words_(stop_words) {
+    for (const std::string &word : stop_words_.GetWords()) {
+        if (!IsValidString(word)) {
+            throw std::invalid_argument(
+                    "Слово `" + word + "` имеет запрещенные символы.");
+        }
     }
 }
 
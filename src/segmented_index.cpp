@@ -0,0 +1,345 @@
+/*
+ * segmented_index.cpp
+ *
+ */
+#include "segmented_index.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+SegmentedIndex::Snapshot::Snapshot(shared_ptr<const SegmentList> segments,
+        const Buffer &buffer) :
+        segments_(move(segments)), buffer_(buffer) {
+}
+
+void SegmentedIndex::Snapshot::GetPostings(string_view term,
+        vector<PostingRange> &result) const {
+    for (const auto &segment : *segments_) {
+        const int term_id = segment->FindTerm(term);
+        if (term_id != TermDictionary::NOT_FOUND) {
+            result.push_back(segment->GetPostings(term_id));
+        }
+    }
+    const auto it = buffer_.find(term);
+    if (it != buffer_.end()) {
+        result.emplace_back(it->second);
+    }
+}
+
+bool SegmentedIndex::Snapshot::ContainsDocument(string_view term,
+        int document_id) const {
+    vector<PostingRange> ranges;
+    GetPostings(term, ranges);
+    return any_of(ranges.begin(), ranges.end(),
+            [document_id](const PostingRange &range) {
+                return range.ContainsDocument(document_id);
+            });
+}
+
+double SegmentedIndex::Snapshot::GetFirstTier(string_view term,
+        vector<PostingRange> &result) const {
+    double rest_max_tf = 0.;
+    for (const auto &segment : *segments_) {
+        const int term_id = segment->FindTerm(term);
+        if (term_id != TermDictionary::NOT_FOUND) {
+            result.push_back(segment->GetFirstTier(term_id));
+            rest_max_tf = max(rest_max_tf, segment->GetRestMaxTf(term_id));
+        }
+    }
+    const auto it = buffer_.find(term);
+    if (it != buffer_.end()) {
+        result.emplace_back(it->second);
+    }
+    return rest_max_tf;
+}
+
+void SegmentedIndex::Snapshot::ForEachTermWithPrefix(string_view prefix,
+        const function<void(string_view)> &callback) const {
+    for (const auto &segment : *segments_) {
+        segment->ForEachTermWithPrefix(prefix, [&callback](string_view term,
+                int) {
+            callback(term);
+        });
+    }
+    for (auto it = buffer_.lower_bound(prefix);
+            it != buffer_.end()
+                    && string_view(it->first).substr(0, prefix.size()) == prefix;
+            ++it) {
+        callback(it->first);
+    }
+}
+
+SegmentedIndex::~SegmentedIndex() {
+    {
+        lock_guard lock(merge_mutex_);
+        stop_ = true;
+    }
+    merge_wakeup_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+}
+
+SegmentedIndex::SegmentedIndex(const SegmentedIndex &other) :
+        buffer_(other.buffer_),
+        buffer_document_count_(other.buffer_document_count_),
+        buffer_size_(other.buffer_size_.load()),
+        first_tier_size_(other.first_tier_size_.load()),
+        segments_(other.GetSegments()) {
+}
+
+SegmentedIndex::SegmentedIndex(SegmentedIndex &&other) :
+        SegmentedIndex() {
+    *this = move(other);
+}
+
+SegmentedIndex& SegmentedIndex::operator=(const SegmentedIndex &other) {
+    if (this != &other) {
+        *this = SegmentedIndex(other);
+    }
+    return *this;
+}
+
+SegmentedIndex& SegmentedIndex::operator=(SegmentedIndex &&other) {
+    if (this == &other) {
+        return *this;
+    }
+    {
+        // слияние прежних сегментов больше не нужно
+        unique_lock lock(merge_mutex_);
+        merge_done_.wait(lock, [this] {
+            return !merging_;
+        });
+    }
+    buffer_ = move(other.buffer_);
+    other.buffer_.clear();
+    buffer_document_count_ = exchange(other.buffer_document_count_, 0);
+    buffer_size_ = other.buffer_size_.load();
+    first_tier_size_ = other.first_tier_size_.load();
+    Publish(other.GetSegments());
+    other.Publish(make_shared<const SegmentList>());
+    return *this;
+}
+
+void SegmentedIndex::AddPosting(string_view term, int document_id, double tf) {
+    auto it = buffer_.lower_bound(term);
+    if (it == buffer_.end() || it->first != term) {
+        it = buffer_.emplace_hint(it, string(term), PostingList());
+    }
+    PostingList &postings = it->second;
+    if (!postings.empty() && postings.back().first == document_id) {
+        postings.back().second += tf;
+    } else {
+        postings.emplace_back(document_id, tf);
+    }
+}
+
+void SegmentedIndex::FinishDocument() {
+    if (++buffer_document_count_ >= buffer_size_) {
+        Flush();
+    }
+}
+
+SegmentedIndex::Snapshot SegmentedIndex::GetSnapshot() const {
+    return Snapshot(GetSegments(), buffer_);
+}
+
+void SegmentedIndex::SetBufferSize(int document_count) {
+    buffer_size_ = max(document_count, 1);
+    if (buffer_document_count_ >= buffer_size_) {
+        Flush();
+    }
+}
+
+size_t SegmentedIndex::GetSegmentCount() const {
+    return GetSegments()->size();
+}
+
+void SegmentedIndex::SetFirstTierSize(size_t posting_count) {
+    first_tier_size_ = posting_count;
+}
+
+size_t SegmentedIndex::GetFirstTierSize() const {
+    return first_tier_size_;
+}
+
+void SegmentedIndex::WaitForMerges() {
+    unique_lock lock(merge_mutex_);
+    merge_done_.wait(lock, [this] {
+        return !merge_requested_ && !merging_;
+    });
+}
+
+void SegmentedIndex::MergeAll() {
+    Flush();
+    unique_lock lock(merge_mutex_);
+    merge_done_.wait(lock, [this] {
+        return !merging_;
+    });
+    const shared_ptr<const SegmentList> segments = GetSegments();
+    if (segments->size() > 1
+            || (segments->size() == 1
+                    && segments->front()->GetFirstTierSize()
+                            != first_tier_size_)) {
+        Publish(make_shared<const SegmentList>(SegmentList {
+                IndexSegment::Merge(*segments, first_tier_size_) }));
+    }
+}
+
+void SegmentedIndex::Remap(const vector<int> &new_ids) {
+    Flush();
+    unique_lock lock(merge_mutex_);
+    merge_done_.wait(lock, [this] {
+        return !merging_;
+    });
+    Publish(make_shared<const SegmentList>(SegmentList {
+            IndexSegment::Merge(*GetSegments(), first_tier_size_, &new_ids) }));
+}
+
+vector<vector<int>> SegmentedIndex::CollectDocumentTerms(int document_count) {
+    MergeAll();
+    vector<vector<int>> document_terms(document_count);
+    for (const auto &segment : *GetSegments()) {
+        for (int term_id = 0; term_id < segment->GetTermCount(); ++term_id) {
+            for (const Posting &posting : segment->GetPostings(term_id)) {
+                document_terms[posting.first].push_back(term_id);
+            }
+        }
+    }
+    return document_terms;
+}
+
+double SegmentedIndex::GetAveragePostingGapBits() const {
+    double bits = 0.;
+    size_t count = 0;
+    auto add_range = [&bits, &count](const PostingRange &range) {
+        int previous = -1;
+        for (const Posting &posting : range) {
+            bits += log2(posting.first - previous);
+            previous = posting.first;
+        }
+        count += range.size();
+    };
+    for (const auto &segment : *GetSegments()) {
+        for (int term_id = 0; term_id < segment->GetTermCount(); ++term_id) {
+            add_range(segment->GetPostings(term_id));
+        }
+    }
+    for (const auto &[term, postings] : buffer_) {
+        add_range(PostingRange(postings));
+    }
+    return count == 0 ? 0. : bits / count;
+}
+
+void SegmentedIndex::AddMemoryUsage(MemoryUsage &usage) const {
+    for (const auto &segment : *GetSegments()) {
+        usage.term_dictionary += segment->GetDictionaryMemoryUsage();
+        usage.postings += segment->GetPostingsMemoryUsage();
+    }
+    for (const auto &[term, postings] : buffer_) {
+        usage.term_dictionary += GetTreeNodeSize<Buffer::value_type>()
+                + GetHeapSize(term);
+        usage.postings += GetHeapSize(postings);
+    }
+}
+
+void SegmentedIndex::Flush() {
+    if (buffer_.empty()) {
+        buffer_document_count_ = 0;
+        return;
+    }
+    auto segment = make_shared<const IndexSegment>(buffer_,
+            first_tier_size_);
+    buffer_.clear();
+    buffer_document_count_ = 0;
+    {
+        lock_guard lock(segments_mutex_);
+        auto segments = make_shared<SegmentList>(*segments_);
+        segments->push_back(move(segment));
+        segments_ = move(segments);
+    }
+    {
+        lock_guard lock(merge_mutex_);
+        merge_requested_ = true;
+        if (!merge_thread_.joinable()) {
+            merge_thread_ = thread([this] {
+                MergeLoop();
+            });
+        }
+    }
+    merge_wakeup_.notify_one();
+}
+
+void SegmentedIndex::Publish(shared_ptr<const SegmentList> segments) {
+    lock_guard lock(segments_mutex_);
+    segments_ = move(segments);
+}
+
+shared_ptr<const SegmentedIndex::SegmentList> SegmentedIndex::GetSegments() const {
+    lock_guard lock(segments_mutex_);
+    return segments_;
+}
+
+SegmentedIndex::SegmentList SegmentedIndex::PickMergeCandidates(
+        const SegmentList &segments) const {
+    map<int, SegmentList> tiers;
+    for (const auto &segment : segments) {
+        int tier = 0;
+        for (long long limit = buffer_size_;
+                segment->GetDocumentCount() > limit; limit *= MERGE_FACTOR) {
+            ++tier;
+        }
+        SegmentList &tier_segments = tiers[tier];
+        tier_segments.push_back(segment);
+        if (tier_segments.size() == MERGE_FACTOR) {
+            return tier_segments;
+        }
+    }
+    return {};
+}
+
+void SegmentedIndex::ReplaceSegments(const SegmentList &merged_from,
+        shared_ptr<const IndexSegment> merged) {
+    lock_guard lock(segments_mutex_);
+    auto segments = make_shared<SegmentList>();
+    for (const auto &segment : *segments_) {
+        const bool is_merged = find(merged_from.begin(), merged_from.end(),
+                segment) != merged_from.end();
+        if (!is_merged) {
+            segments->push_back(segment);
+        } else if (merged) {
+            segments->push_back(move(merged));
+            merged.reset();
+        }
+    }
+    segments_ = move(segments);
+}
+
+void SegmentedIndex::MergeLoop() {
+    unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_wakeup_.wait(lock, [this] {
+            return stop_ || merge_requested_;
+        });
+        if (stop_) {
+            return;
+        }
+        merge_requested_ = false;
+        merging_ = true;
+        SegmentList candidates = PickMergeCandidates(*GetSegments());
+        while (!candidates.empty() && !stop_) {
+            // Слияние выполняется без блокировки: поиск и добавление
+            // документов продолжают работать
+            lock.unlock();
+            shared_ptr<const IndexSegment> merged = IndexSegment::Merge(
+                    candidates, first_tier_size_);
+            ReplaceSegments(candidates, move(merged));
+            lock.lock();
+            candidates = PickMergeCandidates(*GetSegments());
+        }
+        merging_ = false;
+        merge_done_.notify_all();
+    }
+}
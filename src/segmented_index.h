@@ -0,0 +1,129 @@
+#pragma once
+/*
+ * segmented_index.h
+ *
+ *  Инвертированный индекс из неизменяемых сегментов и небольшого
+ *  изменяемого буфера. Новые документы попадают в буфер; заполненный буфер
+ *  превращается в новый сегмент. Фоновый поток сливает сегменты по
+ *  многоуровневой политике: сегменты делятся на уровни по числу документов
+ *  (уровень k — до buffer_size * MERGE_FACTOR^k документов), и как только
+ *  на одном уровне набирается MERGE_FACTOR сегментов, они сливаются в один.
+ *
+ *  Запросы работают со снимком списка сегментов, поэтому фоновое слияние
+ *  не блокирует поиск. Буфер изменяется только при добавлении документов,
+ *  которое, как и раньше, нельзя выполнять одновременно с поиском.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "index_segment.h"
+#include "memory_usage.h"
+
+class SegmentedIndex {
+public:
+    using SegmentList = std::vector<std::shared_ptr<const IndexSegment>>;
+    using Buffer = std::map<std::string, PostingList, std::less<>>;
+
+    static const int MERGE_FACTOR = 4;
+
+    // Согласованный набор сегментов и буфера для выполнения одного запроса
+    class Snapshot {
+    public:
+        Snapshot(std::shared_ptr<const SegmentList> segments,
+                const Buffer &buffer);
+
+        // Добавляет в result списки документов слова из всех сегментов
+        void GetPostings(std::string_view term,
+                std::vector<PostingRange> &result) const;
+        bool ContainsDocument(std::string_view term, int document_id) const;
+        // Добавляет в result первый уровень списков слова из всех сегментов
+        // и возвращает наибольшую частоту слова вне первого уровня или 0.
+        // Буфер не разбивается на уровни и целиком входит в первый уровень
+        double GetFirstTier(std::string_view term,
+                std::vector<PostingRange> &result) const;
+        // Слово, встречающееся в нескольких сегментах, передаётся несколько раз
+        void ForEachTermWithPrefix(std::string_view prefix,
+                const std::function<void(std::string_view)> &callback) const;
+
+    private:
+        std::shared_ptr<const SegmentList> segments_;
+        const Buffer &buffer_;
+    };
+
+    SegmentedIndex() = default;
+    ~SegmentedIndex();
+
+    // Копия разделяет с исходным индексом неизменяемые сегменты и получает
+    // свой буфер; фоновое слияние копии запускается при её первом сегменте.
+    // Копирование нельзя выполнять одновременно с добавлением документов
+    // в исходный индекс
+    SegmentedIndex(const SegmentedIndex &other);
+    SegmentedIndex(SegmentedIndex &&other);
+    SegmentedIndex& operator=(const SegmentedIndex &other);
+    SegmentedIndex& operator=(SegmentedIndex &&other);
+
+    // Документы добавляются по возрастанию внутреннего идентификатора;
+    // повторное слово того же документа увеличивает его частоту
+    void AddPosting(std::string_view term, int document_id, double tf);
+    // Завершает добавление документа; при заполнении буфера создаёт сегмент
+    void FinishDocument();
+
+    Snapshot GetSnapshot() const;
+
+    // Количество документов, при котором буфер превращается в сегмент
+    void SetBufferSize(int document_count);
+    size_t GetSegmentCount() const;
+    // Размер первого уровня длинных списков документов в новых сегментах;
+    // 0 — первый уровень не строится. Существующие сегменты перестраиваются
+    // при MergeAll
+    void SetFirstTierSize(size_t posting_count);
+    size_t GetFirstTierSize() const;
+    void WaitForMerges();
+
+    // Сливает буфер и все сегменты в один сегмент
+    void MergeAll();
+    // Сливает всё в один сегмент, заменяя идентификаторы документов на new_ids
+    void Remap(const std::vector<int> &new_ids);
+    // Слова каждого документа; индекс должен состоять из одного сегмента
+    std::vector<std::vector<int>> CollectDocumentTerms(int document_count);
+    double GetAveragePostingGapBits() const;
+
+    void AddMemoryUsage(MemoryUsage &usage) const;
+
+private:
+    void Flush();
+    void Publish(std::shared_ptr<const SegmentList> segments);
+    std::shared_ptr<const SegmentList> GetSegments() const;
+    // Выбирает сегменты одного уровня для слияния
+    SegmentList PickMergeCandidates(const SegmentList &segments) const;
+    void ReplaceSegments(const SegmentList &merged_from,
+            std::shared_ptr<const IndexSegment> merged);
+    void MergeLoop();
+
+    Buffer buffer_;
+    int buffer_document_count_ = 0;
+    // читается потоком слияния
+    std::atomic<int> buffer_size_ { 4096 };
+    std::atomic<size_t> first_tier_size_ { 0 };
+
+    mutable std::mutex segments_mutex_;
+    std::shared_ptr<const SegmentList> segments_ = std::make_shared<
+            const SegmentList>();
+
+    // Удерживается на время слияния, чтобы фоновое и явное слияния
+    // не выполнялись одновременно
+    std::mutex merge_mutex_;
+    std::condition_variable merge_wakeup_;
+    std::condition_variable merge_done_;
+    bool merge_requested_ = false;
+    bool merging_ = false;
+    bool stop_ = false;
+    std::thread merge_thread_;
+};
@@ -0,0 +1,75 @@
+/*
+ * stop_word_filter.cpp
+ *
+ */
+#include "stop_word_filter.h"
+#include <algorithm>
+#include <utility>
+#include "memory_usage.h"
+
+using namespace std;
+
+void StopWordFilter::Build(vector<string_view> words) {
+    words.erase(remove(words.begin(), words.end(), string_view()),
+            words.end());
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        return;
+    }
+
+    for (const string_view word : words) {
+        prefilter_.Add(word);
+    }
+    const size_t bucket_count = perfect_hash::GetBucketCount(words.size());
+    vector<uint64_t> hashes(words.size());
+    vector<uint32_t> displacements(bucket_count);
+    vector<int> slot_keys(words.size());
+    vector<size_t> bucket_keys(words.size());
+    vector<size_t> bucket_starts(bucket_count + 1);
+    vector<size_t> bucket_order(bucket_count);
+    // слова различны, поэтому с другой затравкой таблица строится
+    bool built = false;
+    for (; !built && seed_ < perfect_hash::MAX_SEED_ATTEMPTS; ++seed_) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            hashes[i] = perfect_hash::HashBytes(words[i], seed_);
+        }
+        built = perfect_hash::AssignSlots(hashes.data(), words.size(),
+                displacements.data(), bucket_count, slot_keys.data(),
+                bucket_keys.data(), bucket_starts.data(), bucket_order.data());
+    }
+    if (!built) {
+        throw runtime_error(
+                "Не удалось построить хеш-таблицу стоп-слов."s);
+    }
+    --seed_;
+
+    displacements_ = move(displacements);
+    fingerprints_.reserve(words.size());
+    offsets_.reserve(words.size() + 1);
+    for (const int key : slot_keys) {
+        AddSlotWord(words[key], hashes[key]);
+    }
+    offsets_.push_back(words_data_.size());
+}
+
+void StopWordFilter::AddSlotWord(string_view word, uint64_t fingerprint) {
+    fingerprints_.push_back(fingerprint);
+    offsets_.push_back(words_data_.size());
+    words_data_ += word;
+}
+
+vector<string> StopWordFilter::GetWords() const {
+    vector<string> result;
+    result.reserve(GetSize());
+    for (size_t slot = 0; slot < GetSize(); ++slot) {
+        result.emplace_back(GetWord(slot));
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+size_t StopWordFilter::GetMemoryUsage() const {
+    return GetHeapSize(displacements_) + GetHeapSize(fingerprints_)
+            + GetHeapSize(words_data_) + GetHeapSize(offsets_);
+}
@@ -0,0 +1,169 @@
+#pragma once
+/*
+ * stop_word_filter.h
+ *
+ *  Набор стоп-слов, скомпилированный в минимальную совершенную хеш-таблицу.
+ *  Проверка слова: отсев по длине и первому байту, затем хеш, ячейка
+ *  таблицы и сравнение 64-битного отпечатка; байты строки сравниваются
+ *  только при совпадении отпечатка. Набор неизменяем после построения
+ *  и безопасен для чтения из нескольких потоков.
+ */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "perfect_hash.h"
+
+// Вариант для списка, известного при компиляции: таблица строится
+// компилятором, пустое или повторяющееся слово — ошибка компиляции.
+// SearchServer принимает его в конструкторе и только копирует таблицу.
+template<size_t N>
+class StaticStopWordFilter {
+public:
+    constexpr explicit StaticStopWordFilter(
+            const std::array<std::string_view, N> &words) {
+        for (size_t i = 0; i < N; ++i) {
+            if (words[i].empty()) {
+                throw std::invalid_argument("Стоп-слово не может быть пустым.");
+            }
+            for (size_t j = i + 1; j < N; ++j) {
+                if (words[i] == words[j]) {
+                    throw std::invalid_argument(
+                            "Список стоп-слов содержит повторяющиеся слова.");
+                }
+            }
+            prefilter_.Add(words[i]);
+        }
+        uint64_t hashes[N > 0 ? N : 1] = { };
+        int slot_keys[N > 0 ? N : 1] = { };
+        size_t bucket_keys[N > 0 ? N : 1] = { };
+        size_t bucket_starts[BUCKET_COUNT + 1] = { };
+        size_t bucket_order[BUCKET_COUNT] = { };
+        bool built = false;
+        for (; !built && seed_ < perfect_hash::MAX_SEED_ATTEMPTS; ++seed_) {
+            for (size_t i = 0; i < N; ++i) {
+                hashes[i] = perfect_hash::HashBytes(words[i], seed_);
+            }
+            built = perfect_hash::AssignSlots(hashes, N, displacements_,
+                    BUCKET_COUNT, slot_keys, bucket_keys, bucket_starts,
+                    bucket_order);
+        }
+        if (!built) {
+            throw std::invalid_argument(
+                    "Не удалось построить хеш-таблицу стоп-слов.");
+        }
+        --seed_;
+        for (size_t slot = 0; slot < N; ++slot) {
+            words_[slot] = words[slot_keys[slot]];
+            fingerprints_[slot] = hashes[slot_keys[slot]];
+        }
+    }
+
+    constexpr bool Contains(std::string_view word) const {
+        if (N == 0 || !prefilter_.MayContain(word)) {
+            return false;
+        }
+        const uint64_t hash = perfect_hash::HashBytes(word, seed_);
+        const size_t slot = perfect_hash::GetSlot(hash,
+                displacements_[perfect_hash::GetBucket(hash, BUCKET_COUNT)], N);
+        return fingerprints_[slot] == hash && words_[slot] == word;
+    }
+
+    constexpr size_t GetSize() const {
+        return N;
+    }
+
+private:
+    friend class StopWordFilter;
+
+    static constexpr size_t BUCKET_COUNT = perfect_hash::GetBucketCount(N);
+
+    perfect_hash::Prefilter prefilter_;
+    uint64_t seed_ = 0;
+    uint32_t displacements_[BUCKET_COUNT] = { };
+    uint64_t fingerprints_[N > 0 ? N : 1] = { };
+    // слова в порядке ячеек таблицы
+    std::string_view words_[N > 0 ? N : 1] = { };
+};
+
+template<size_t N>
+StaticStopWordFilter(const std::array<std::string_view, N>&)
+        -> StaticStopWordFilter<N>;
+
+class StopWordFilter {
+public:
+    StopWordFilter() = default;
+
+    // Пустые слова пропускаются, повторы допускаются
+    template<typename Container>
+    explicit StopWordFilter(const Container &words);
+
+    // Копирует таблицу, построенную при компиляции
+    template<size_t N>
+    explicit StopWordFilter(const StaticStopWordFilter<N> &filter);
+
+    bool Contains(std::string_view word) const {
+        if (offsets_.size() < 2 || !prefilter_.MayContain(word)) {
+            return false;
+        }
+        const uint64_t hash = perfect_hash::HashBytes(word, seed_);
+        const size_t slot = perfect_hash::GetSlot(hash,
+                displacements_[perfect_hash::GetBucket(hash,
+                        displacements_.size())], fingerprints_.size());
+        return fingerprints_[slot] == hash && GetWord(slot) == word;
+    }
+
+    size_t GetSize() const {
+        return fingerprints_.size();
+    }
+
+    // Слова в лексикографическом порядке
+    std::vector<std::string> GetWords() const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    void Build(std::vector<std::string_view> words);
+    void AddSlotWord(std::string_view word, uint64_t fingerprint);
+
+    std::string_view GetWord(size_t slot) const {
+        return std::string_view(words_data_).substr(offsets_[slot],
+                offsets_[slot + 1] - offsets_[slot]);
+    }
+
+    perfect_hash::Prefilter prefilter_;
+    uint64_t seed_ = 0;
+    std::vector<uint32_t> displacements_;
+    std::vector<uint64_t> fingerprints_;
+    // слова, упакованные в порядке ячеек таблицы
+    std::string words_data_;
+    std::vector<size_t> offsets_;
+};
+
+template<typename Container>
+StopWordFilter::StopWordFilter(const Container &words) {
+    std::vector<std::string_view> views;
+    for (const auto &word : words) {
+        views.emplace_back(word);
+    }
+    Build(std::move(views));
+}
+
+template<size_t N>
+StopWordFilter::StopWordFilter(const StaticStopWordFilter<N> &filter) :
+        prefilter_(filter.prefilter_), seed_(filter.seed_),
+        displacements_(std::begin(filter.displacements_),
+                std::end(filter.displacements_)) {
+    if (N == 0) {
+        return;
+    }
+    fingerprints_.reserve(N);
+    offsets_.reserve(N + 1);
+    for (size_t slot = 0; slot < N; ++slot) {
+        AddSlotWord(filter.words_[slot], filter.fingerprints_[slot]);
+    }
+    offsets_.push_back(words_data_.size());
+}
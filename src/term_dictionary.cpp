@@ -0,0 +1,219 @@
+/*
+ * term_dictionary.cpp
+ *
+ */
+#include "term_dictionary.h"
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+void WriteVarint(string &out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t ReadVarint(const char *&pos) {
+    size_t value = 0;
+    int shift = 0;
+    while (true) {
+        const unsigned char byte = static_cast<unsigned char>(*pos++);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+        shift += 7;
+    }
+}
+
+bool StartsWith(string_view term, string_view prefix) {
+    return term.substr(0, prefix.size()) == prefix;
+}
+
+}
+
+template<typename Callback>
+void TermDictionary::ScanBlocks(size_t block, string &current,
+        Callback callback) const {
+    current.clear();
+    const char *pos = blocks_data_.data() + block_offsets_[block];
+    const char *end = blocks_data_.data() + blocks_data_.size();
+    size_t index = block * BLOCK_SIZE;
+    while (pos != end) {
+        if (index % BLOCK_SIZE == 0) {
+            const size_t size = ReadVarint(pos);
+            current.assign(pos, size);
+            pos += size;
+        } else {
+            const size_t shared = ReadVarint(pos);
+            const size_t suffix = ReadVarint(pos);
+            current.resize(shared);
+            current.append(pos, suffix);
+            pos += suffix;
+        }
+        const int id = static_cast<int>(ReadVarint(pos));
+        ++index;
+        if (!callback(string_view(current), id)) {
+            return;
+        }
+    }
+}
+
+int TermDictionary::Find(string_view term) const {
+    const auto pending_it = pending_.find(term);
+    if (pending_it != pending_.end()) {
+        return pending_it->second;
+    }
+    if (block_offsets_.empty()) {
+        return NOT_FOUND;
+    }
+    // буфер живёт в потоке, поэтому длинные слова не выделяют память
+    // при каждом поиске
+    static thread_local string current_buffer;
+    int result = NOT_FOUND;
+    size_t scanned = 0;
+    ScanBlocks(FindBlock(term), current_buffer,
+            [&](string_view current, int id) {
+        if (current == term) {
+            result = id;
+        }
+        return current < term && ++scanned < BLOCK_SIZE;
+    });
+    return result;
+}
+
+int TermDictionary::Insert(string_view term) {
+    const int id = Find(term);
+    if (id != NOT_FOUND) {
+        return id;
+    }
+    const int new_id = static_cast<int>(GetSize());
+    pending_.emplace(string(term), new_id);
+    if (pending_.size() >= max(MIN_PENDING_SIZE, blocks_term_count_ / 8)) {
+        Compact();
+    }
+    return new_id;
+}
+
+size_t TermDictionary::GetSize() const {
+    return blocks_term_count_ + pending_.size();
+}
+
+void TermDictionary::ForEachWithPrefix(string_view prefix,
+        const function<void(string_view, int)> &callback) const {
+    vector<pair<string, int>> from_blocks;
+    if (!block_offsets_.empty()) {
+        string current_buffer;
+        ScanBlocks(FindBlock(prefix), current_buffer,
+                [&](string_view current, int id) {
+            if (StartsWith(current, prefix)) {
+                from_blocks.emplace_back(current, id);
+                return true;
+            }
+            return current < prefix;
+        });
+    }
+    // Слияние результатов из блоков и буфера новых слов
+    auto pending_it = pending_.lower_bound(prefix);
+    auto blocks_it = from_blocks.begin();
+    while (true) {
+        const bool has_pending = pending_it != pending_.end()
+                && StartsWith(pending_it->first, prefix);
+        if (!has_pending && blocks_it == from_blocks.end()) {
+            break;
+        }
+        if (has_pending
+                && (blocks_it == from_blocks.end()
+                        || pending_it->first < blocks_it->first)) {
+            callback(pending_it->first, pending_it->second);
+            ++pending_it;
+        } else {
+            callback(blocks_it->first, blocks_it->second);
+            ++blocks_it;
+        }
+    }
+}
+
+void TermDictionary::Compact() {
+    if (pending_.empty()) {
+        return;
+    }
+    vector<pair<string, int>> terms;
+    terms.reserve(GetSize());
+    if (!block_offsets_.empty()) {
+        string current_buffer;
+        ScanBlocks(0, current_buffer, [&terms](string_view current, int id) {
+            terms.emplace_back(current, id);
+            return true;
+        });
+    }
+    const size_t middle = terms.size();
+    for (auto &[term, id] : pending_) {
+        terms.emplace_back(term, id);
+    }
+    inplace_merge(terms.begin(), terms.begin() + middle, terms.end());
+
+    string data;
+    vector<size_t> offsets;
+    offsets.reserve((terms.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const string &term = terms[i].first;
+        if (i % BLOCK_SIZE == 0) {
+            offsets.push_back(data.size());
+            WriteVarint(data, term.size());
+            data += term;
+        } else {
+            const string &previous = terms[i - 1].first;
+            size_t shared = 0;
+            while (shared < term.size() && shared < previous.size()
+                    && term[shared] == previous[shared]) {
+                ++shared;
+            }
+            WriteVarint(data, shared);
+            WriteVarint(data, term.size() - shared);
+            data.append(term, shared, string::npos);
+        }
+        WriteVarint(data, terms[i].second);
+    }
+    data.shrink_to_fit();
+
+    blocks_data_ = move(data);
+    block_offsets_ = move(offsets);
+    blocks_term_count_ = terms.size();
+    pending_.clear();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    size_t result = GetHeapSize(blocks_data_) + GetHeapSize(block_offsets_);
+    for (const auto &[term, id] : pending_) {
+        result += GetTreeNodeSize<pair<const string, int>>() + GetHeapSize(term);
+    }
+    return result;
+}
+
+string_view TermDictionary::GetBlockFirstTerm(size_t block) const {
+    const char *pos = blocks_data_.data() + block_offsets_[block];
+    const size_t size = ReadVarint(pos);
+    return string_view(pos, size);
+}
+
+// Последний блок, первое слово которого не больше term
+size_t TermDictionary::FindBlock(string_view term) const {
+    size_t left = 0;
+    size_t right = block_offsets_.size();
+    while (right - left > 1) {
+        const size_t middle = (left + right) / 2;
+        if (GetBlockFirstTerm(middle) <= term) {
+            left = middle;
+        } else {
+            right = middle;
+        }
+    }
+    return left;
+}
+
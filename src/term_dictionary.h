@@ -0,0 +1,58 @@
+#pragma once
+/*
+ * term_dictionary.h
+ *
+ *  Компактный упорядоченный словарь слов индекса. Слова хранятся
+ *  отсортированными блоками с фронтальным сжатием: первое слово блока
+ *  записывается целиком, остальные — как длина общего префикса
+ *  с предыдущим словом и оставшийся суффикс. Идентификаторы слов
+ *  выдаются по порядку добавления и не меняются при перестроении.
+ *
+ *  Новые слова сначала попадают в небольшой изменяемый буфер, который
+ *  сливается с блоками, когда вырастает до доли от размера словаря.
+ */
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memory_usage.h"
+
+class TermDictionary {
+public:
+    static constexpr int NOT_FOUND = -1;
+
+    // Возвращает идентификатор слова или NOT_FOUND
+    int Find(std::string_view term) const;
+    // Возвращает идентификатор слова, добавляя его при отсутствии
+    int Insert(std::string_view term);
+
+    size_t GetSize() const;
+
+    // Перебирает в порядке возрастания все слова, начинающиеся с prefix
+    void ForEachWithPrefix(std::string_view prefix,
+            const std::function<void(std::string_view, int)> &callback) const;
+
+    // Сливает буфер новых слов с блоками
+    void Compact();
+
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr int BLOCK_SIZE = 16;
+    static constexpr size_t MIN_PENDING_SIZE = 256;
+
+    std::string_view GetBlockFirstTerm(size_t block) const;
+    size_t FindBlock(std::string_view term) const;
+    // Перебирает блоки, начиная с block, пока callback возвращает true.
+    // Слова восстанавливаются в current: переданный вызывающим буфер
+    // переиспользуется, и поиск слова не выделяет память
+    template<typename Callback>
+    void ScanBlocks(size_t block, std::string &current,
+            Callback callback) const;
+
+    std::string blocks_data_;
+    std::vector<size_t> block_offsets_;
+    size_t blocks_term_count_ = 0;
+    std::map<std::string, int, std::less<>> pending_;
+};
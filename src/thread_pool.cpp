@@ -0,0 +1,105 @@
+/*
+ * thread_pool.cpp
+ *
+ */
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+// Пул и номер очереди, которыми владеет текущий поток
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard lock(wait_mutex_);
+        stop_ = true;
+    }
+    wake_up_.notify_all();
+    for (thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size();
+}
+
+void ThreadPool::Push(Task task) {
+    // Задачи, порождённые внутри пула, остаются в очереди своего потока
+    const size_t index =
+            current_pool == this ?
+                    current_index : next_queue_++ % queues_.size();
+    {
+        lock_guard lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard lock(wait_mutex_);
+        ++pending_;
+    }
+    wake_up_.notify_one();
+}
+
+bool ThreadPool::TryPopLocal(size_t index, Task &task) {
+    WorkQueue &queue = *queues_[index];
+    lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::TrySteal(size_t index, Task &task) {
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        WorkQueue &queue = *queues_[(index + i) % queues_.size()];
+        lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        {
+            unique_lock lock(wait_mutex_);
+            wake_up_.wait(lock, [this] {
+                return stop_ || pending_ > 0;
+            });
+            if (pending_ == 0) {
+                return;
+            }
+            --pending_;
+        }
+        // pending_ уменьшен, значит одна задача зарезервирована за потоком
+        Task task;
+        while (!TryPopLocal(index, task) && !TrySteal(index, task)) {
+            this_thread::yield();
+        }
+        task();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+/*
+ * thread_pool.h
+ *
+ *  Пул потоков с перехватом задач (work stealing): у каждого потока своя
+ *  очередь, новые задачи потока кладутся в её конец и берутся оттуда же,
+ *  а простаивающий поток забирает задачи из начала чужих очередей.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename Func>
+    auto Submit(Func func) -> std::future<decltype(func())>;
+
+    size_t GetThreadCount() const;
+
+private:
+    using Task = std::function<void()>;
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Push(Task task);
+    bool TryPopLocal(size_t index, Task &task);
+    bool TrySteal(size_t index, Task &task);
+    void WorkerLoop(size_t index);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex wait_mutex_;
+    std::condition_variable wake_up_;
+    size_t pending_ = 0;
+    bool stop_ = false;
+    std::atomic<size_t> next_queue_ { 0 };
+};
+
+template<typename Func>
+auto ThreadPool::Submit(Func func) -> std::future<decltype(func())> {
+    using Result = decltype(func());
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+            std::move(func));
+    std::future<Result> result = task->get_future();
+    Push([task] {
+        (*task)();
+    });
+    return result;
+}
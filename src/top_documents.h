@@ -0,0 +1,43 @@
+#pragma once
+/*
+ * top_documents.h
+ *
+ *  Ограниченная выборка лучших документов. Хранит не больше limit документов
+ *  в куче, на вершине которой худший из отобранных, поэтому память
+ *  пропорциональна limit, а не числу кандидатов.
+ */
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "document.h"
+
+template<typename Ordering>
+class TopDocuments {
+public:
+    // limit задаёт вызывающий, поэтому память заранее не резервируется:
+    // куча растёт не больше чем до числа добавленных документов
+    explicit TopDocuments(size_t limit) :
+            limit_(limit) {
+    }
+
+    void Add(const Document &document) {
+        if (heap_.size() < limit_) {
+            heap_.push_back(document);
+            std::push_heap(heap_.begin(), heap_.end(), Ordering::IsBetter);
+        } else if (limit_ > 0 && Ordering::IsBetter(document, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), Ordering::IsBetter);
+            heap_.back() = document;
+            std::push_heap(heap_.begin(), heap_.end(), Ordering::IsBetter);
+        }
+    }
+
+    // Документы от лучшего к худшему; выборка после вызова пуста
+    std::vector<Document> Extract() {
+        std::sort_heap(heap_.begin(), heap_.end(), Ordering::IsBetter);
+        return std::move(heap_);
+    }
+
+private:
+    size_t limit_;
+    std::vector<Document> heap_;
+};
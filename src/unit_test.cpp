@@ -7,10 +7,23 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <csignal>
+#include <sys/resource.h>
 #include "search_server.h"
 #include "unit_test.h"
 #include "request_queue.h"
 #include "paginator.h"
+#include "async_search.h"
+#include "corpus_ingestor.h"
+#include "load_generator.h"
+#include "process_queries.h"
+#include "index_snapshot.h"
+#include "stop_word_filter.h"
+#include "binary_io.h"
 
 using namespace std;
 
@@ -253,10 +266,1252 @@ void TestFilterUserPredicateDoc() {
 
 }
 
+void TestQueryStats() {
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL,
+            { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL,
+            { 1, 2, 3 });
+    server.AddDocument(3, "big cat fancy collar"s, DocumentStatus::BANNED,
+            { 1, 2, 8 });
+
+    QueryStats stats;
+    const auto documents = server.FindTopDocuments("curly cat fancy -dog"s,
+            stats);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(stats.terms_resolved, 4u);
+    ASSERT_EQUAL_HINT(stats.postings_scanned, 7u,
+            "Должны учитываться списки документов плюс- и минус-слов."s);
+    ASSERT_EQUAL(stats.candidates, 3u);
+    ASSERT_EQUAL(stats.minus_eliminated, 1u);
+    ASSERT_EQUAL(stats.filter_rejected, 1u);
+
+    QueryStats match_stats;
+    const auto [words, status] = server.MatchDocument("curly -dog"s, 2,
+            match_stats);
+    ASSERT_EQUAL(words.empty(), true);
+    ASSERT_EQUAL(match_stats.minus_eliminated, 1u);
+
+    RequestQueue request_queue(server, true);
+    for (int i = 0; i < 1500; ++i) {
+        request_queue.AddFindRequest("curly"s);
+    }
+    ASSERT_EQUAL_HINT(request_queue.GetLatencyHistogram().GetCount(), 1440u,
+            "Гистограмма должна содержать только запросы текущего окна."s);
+    ASSERT_EQUAL(
+            request_queue.GetLatencyHistogram(QueryStage::SCORE).GetCount(),
+            1440u);
+    ASSERT_EQUAL(
+            request_queue.GetLatencyHistogram().GetPercentile(50)
+                    <= request_queue.GetLatencyHistogram().GetPercentile(99),
+            true);
+
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 100; ++i) {
+        histogram.Add(chrono::nanoseconds(i * 1000));
+    }
+    const auto p95 = histogram.GetPercentile(95).count();
+    ASSERT_EQUAL_HINT(p95 >= 95000 && p95 <= 95000 * 17 / 16, true,
+            "Погрешность перцентиля не должна превышать размер корзины."s);
+}
+
+void TestAsyncSearch() {
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL,
+            { 8, -3 });
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,
+            DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s,
+            DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+    server.AddDocument(3, "ухоженный скворец евгений"s, DocumentStatus::BANNED,
+            { 9 });
+
+    AsyncSearchServer async_server(server, 4);
+    const auto deadline = AsyncSearchServer::Clock::now() + chrono::hours(1);
+    vector<future<AsyncSearchResult>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(
+                async_server.FindTopDocuments("пушистый ухоженный кот"s,
+                        deadline));
+    }
+    const auto expected = server.FindTopDocuments("пушистый ухоженный кот"s);
+    for (auto &result_future : futures) {
+        const AsyncSearchResult result = result_future.get();
+        ASSERT_EQUAL(result.truncated, false);
+        ASSERT_EQUAL(result.documents.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(result.documents[i].id, expected[i].id);
+        }
+    }
+
+    const AsyncSearchResult expired = async_server.FindTopDocuments(
+            "пушистый ухоженный кот"s, DocumentStatus::BANNED,
+            AsyncSearchServer::Clock::now()).get();
+    ASSERT_EQUAL_HINT(expired.truncated, true,
+            "Запрос с истекшим сроком должен быть прерван."s);
+    ASSERT_EQUAL(expired.documents.empty(), true);
+
+    CancellationToken token;
+    token.Cancel();
+    const AsyncSearchResult cancelled = async_server.FindTopDocuments(
+            "пушистый кот"s, deadline, token).get();
+    ASSERT_EQUAL_HINT(cancelled.truncated, true,
+            "Отменённый запрос должен быть прерван."s);
+
+    bool thrown = false;
+    try {
+        async_server.FindTopDocuments("кот --пёс"s, deadline).get();
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Исключение запроса должно передаваться через future."s);
+}
+
+void TestCorpusIngestion() {
+    const string path = (filesystem::temp_directory_path()
+            / "search_engine_corpus_test.tsv").string();
+    {
+        ofstream out(path);
+        out << "0\tACTUAL\t8 -3\tбелый кот и модный ошейник\n"s;
+        out << "1\tACTUAL\t7 2 7\tпушистый кот пушистый хвост\r\n"s;
+        out << "2\t0\t5 -12 2 1\tухоженный пёс выразительные глаза\n"s;
+        out << "\n"s;
+        out << "3\tBANNED\t9\tухоженный скворец евгений\n"s;
+        out << "4\tACTUAL\t1\tи в на"s;
+    }
+
+    SearchServer expected("и в на"s);
+    expected.AddDocument(0, "белый кот и модный ошейник"s,
+            DocumentStatus::ACTUAL, { 8, -3 });
+    expected.AddDocument(1, "пушистый кот пушистый хвост"s,
+            DocumentStatus::ACTUAL, { 7, 2, 7 });
+    expected.AddDocument(2, "ухоженный пёс выразительные глаза"s,
+            DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+    expected.AddDocument(3, "ухоженный скворец евгений"s,
+            DocumentStatus::BANNED, { 9 });
+    // документ только из стоп-слов допустим, как и в строковом AddDocument
+    expected.AddDocument(4, "и в на"s, DocumentStatus::ACTUAL, { 1 });
+
+    SearchServer server("и в на"s);
+    IngestionOptions options;
+    options.chunk_size = 16;
+    options.tokenizer_threads = 3;
+    options.queue_capacity = 2;
+    size_t progress_calls = 0;
+    options.on_progress = [&progress_calls](const IngestionProgress&) {
+        ++progress_calls;
+    };
+    const IngestionStats stats = CorpusIngestor(server, options).Ingest(path);
+    ASSERT_EQUAL(stats.index.documents, 5u);
+    ASSERT_EQUAL(progress_calls > 0, true);
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    for (int i = 0; i < server.GetDocumentCount(); ++i) {
+        ASSERT_EQUAL_HINT(server.GetDocumentId(i), i,
+                "Документы должны добавляться в порядке следования в файле."s);
+    }
+
+    for (const DocumentStatus status : { DocumentStatus::ACTUAL,
+            DocumentStatus::BANNED }) {
+        const auto documents = server.FindTopDocuments(
+                "пушистый ухоженный кот"s, status);
+        const auto expected_documents = expected.FindTopDocuments(
+                "пушистый ухоженный кот"s, status);
+        ASSERT_EQUAL(documents.size(), expected_documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+            ASSERT_EQUAL(documents[i].rating, expected_documents[i].rating);
+            ASSERT_EQUAL(
+                    abs(documents[i].relevance
+                            - expected_documents[i].relevance) < EPSILON, true);
+        }
+    }
+
+    {
+        ofstream out(path);
+        out << "5\tACTUAL\t1\tкот\n"s;
+        out << "5\tACTUAL\t1\tпёс\n"s;
+    }
+    bool thrown = false;
+    try {
+        SearchServer duplicate_server;
+        CorpusIngestor(duplicate_server, options).Ingest(path);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Повторный идентификатор документа должен приводить к ошибке."s);
+    thrown = false;
+    try {
+        server.TokenizeDocument(7, ""sv, DocumentStatus::ACTUAL, { });
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true, "Пустой документ должен отклоняться."s);
+    filesystem::remove(path);
+}
+
+void TestTermDictionary() {
+    TermDictionary dictionary;
+    vector<string> terms;
+    for (int i = 0; i < 5000; ++i) {
+        terms.push_back("кот"s + to_string(i * 7919 % 5000));
+    }
+    for (int i = 0; i < static_cast<int>(terms.size()); ++i) {
+        ASSERT_EQUAL(dictionary.Insert(terms[i]), i);
+    }
+    ASSERT_EQUAL(dictionary.Insert(terms[42]), 42);
+    ASSERT_EQUAL(dictionary.GetSize(), terms.size());
+    for (int i = 0; i < static_cast<int>(terms.size()); ++i) {
+        ASSERT_EQUAL_HINT(dictionary.Find(terms[i]), i,
+                "Идентификатор слова не должен меняться при перестроении."s);
+    }
+    ASSERT_EQUAL(dictionary.Find("кот"s), TermDictionary::NOT_FOUND);
+    ASSERT_EQUAL(dictionary.Find("пёс"s), TermDictionary::NOT_FOUND);
+
+    vector<string> with_prefix;
+    dictionary.ForEachWithPrefix("кот12"s, [&](string_view term, int) {
+        with_prefix.emplace_back(term);
+    });
+    ASSERT_EQUAL(with_prefix.size(), 111u);
+    ASSERT_EQUAL(is_sorted(with_prefix.begin(), with_prefix.end()), true);
+    dictionary.Compact();
+    size_t all_count = 0;
+    dictionary.ForEachWithPrefix(""s, [&](string_view, int) {
+        ++all_count;
+    });
+    ASSERT_EQUAL(all_count, terms.size());
+
+    // длинные слова, которые не помещаются в буфер короткой строки
+    TermDictionary long_terms;
+    for (int i = 0; i < 300; ++i) {
+        long_terms.Insert("достопримечательность"s + to_string(i));
+    }
+    long_terms.Compact();
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_EQUAL(long_terms.Find("достопримечательность"s + to_string(i)),
+                i);
+    }
+    ASSERT_EQUAL(long_terms.Find("достопримечательность"s),
+            TermDictionary::NOT_FOUND);
+
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL,
+            { 8, -3 });
+    server.AddDocument(1, "пушистый котёнок пушистый хвост"s,
+            DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s,
+            DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+    server.AddDocument(3, "кота не видно"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("кот*"s).size(), 3u,
+            "Слово с '*' должно находить все слова с этим префиксом."s);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("кот* -кота"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("пёс -кот*"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("хвост -кот*"s).empty(), true);
+
+    const auto [words, status] = server.MatchDocument("кот* хвост"s, 1);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(words[0], "котёнок"s);
+    ASSERT_EQUAL(words[1], "хвост"s);
+}
+
+// Политика с обратным порядком выдачи по рейтингу
+struct LowRatingFirstRanking: TfIdfRanking {
+    static bool IsBetter(const Document &lhs, const Document &rhs) {
+        return lhs.rating < rhs.rating;
+    }
+};
+
+void TestRankingPolicy() {
+    SearchServer server;
+    server.AddDocument(0, "кот кот пёс"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(1, "кот хвост хвост хвост хвост хвост"s,
+            DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(2, "пёс"s, DocumentStatus::BANNED, { 3 });
+
+    const auto tf_idf = server.FindTopDocuments("кот"s);
+    ASSERT_EQUAL(tf_idf.size(), 2u);
+    ASSERT_EQUAL(abs(tf_idf[0].relevance - log(1.5) * 2. / 3.) < EPSILON, true);
+
+    const auto bm25 = server.FindTopDocuments<Bm25Ranking>("кот"s);
+    ASSERT_EQUAL(bm25.size(), 2u);
+    const double idf = log(1. + 1.5 / 2.5);
+    const double average_length = 10. / 3.;
+    const double norm0 = 1.2 * (0.25 + 0.75 * 3. / average_length);
+    const double norm1 = 1.2 * (0.25 + 0.75 * 6. / average_length);
+    ASSERT_EQUAL(bm25[0].id, 0);
+    ASSERT_EQUAL_HINT(
+            abs(bm25[0].relevance - idf * 2. * 2.2 / (2. + norm0)) < EPSILON,
+            true, "Не правильно считается релевантность BM25."s);
+    ASSERT_EQUAL(
+            abs(bm25[1].relevance - idf * 1. * 2.2 / (1. + norm1)) < EPSILON,
+            true);
+
+    const auto banned = server.FindTopDocuments<Bm25Ranking>("пёс"s,
+            DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned.size(), 1u);
+    ASSERT_EQUAL(banned[0].id, 2);
+
+    const auto by_rating = server.FindTopDocuments<LowRatingFirstRanking>(
+            "кот"s, [](int document_id, DocumentStatus status, int rating) {
+                return status == DocumentStatus::ACTUAL;
+            });
+    ASSERT_EQUAL_HINT(by_rating[0].id, 0,
+            "Порядок выдачи должен задаваться политикой ранжирования."s);
+}
+
+void TestLoadGenerator() {
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL,
+            { 7, 2, 7 });
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL,
+            { 1, 2, 3 });
+    server.AddDocument(3, "big cat fancy collar"s, DocumentStatus::ACTUAL,
+            { 1, 2, 8 });
+    const vector<string> queries = { "curly dog"s, "empty request"s,
+            "big collar"s, "sparrow"s };
+
+    LoadGeneratorOptions options;
+    options.threads = 4;
+    options.requests = 400;
+    options.warmup = 20;
+    const LoadReport report = ReplayQueryLog(server, queries, options);
+    ASSERT_EQUAL(report.requests, 400u);
+    ASSERT_EQUAL(report.errors, 0u);
+    ASSERT_EQUAL(report.latency.GetCount(), 400u);
+    ASSERT_EQUAL_HINT(abs(report.empty_result_ratio - 0.5) < EPSILON, true,
+            "Половина запросов журнала не должна ничего находить."s);
+    ASSERT_EQUAL(report.peak_rss_kb > 0, true);
+
+    options.threads = 2;
+    options.requests = 20;
+    options.warmup = 0;
+    options.rate = 1000.;
+    const LoadReport paced = ReplayQueryLog(server, queries, options);
+    ASSERT_EQUAL_HINT(paced.elapsed >= chrono::milliseconds(19), true,
+            "Запросы должны поступать с заданной частотой."s);
+
+    // прогрев состоит из пустых запросов, а некорректные запросы не имеют
+    // задержки выполнения
+    options.threads = 1;
+    options.requests = 10;
+    options.warmup = 3;
+    options.rate = 0.;
+    const LoadReport with_errors = ReplayQueryLog(server, { "sparrow"s,
+            "sparrow"s, "sparrow"s, "curly dog"s, "cat --dog"s }, options);
+    ASSERT_EQUAL(with_errors.requests, 10u);
+    ASSERT_EQUAL(with_errors.errors, 2u);
+    ASSERT_EQUAL_HINT(with_errors.latency.GetCount(), 8u,
+            "Ошибочные запросы не попадают в гистограмму задержек."s);
+    ASSERT_EQUAL_HINT(abs(with_errors.empty_result_ratio - 0.75) < EPSILON,
+            true, "Доля пустых результатов считается после прогрева."s);
+}
+
+void TestMemoryUsage() {
+    SearchServer server("и в на"s);
+    const MemoryUsage empty_usage = server.GetMemoryUsage();
+    ASSERT_EQUAL(empty_usage.postings, 0u);
+    ASSERT_EQUAL(empty_usage.stop_words > 0, true);
+
+    for (int i = 0; i < 1000; ++i) {
+        server.AddDocument(i,
+                "кот"s + to_string(i % 37) + " пёс"s + to_string(i % 101)
+                        + " и хвост"s, DocumentStatus::ACTUAL, { i % 10 });
+    }
+    const auto before = server.FindTopDocuments("хвост кот5 пёс7"s);
+    const MemoryUsage usage = server.GetMemoryUsage();
+    ASSERT_EQUAL(usage.term_dictionary > 0, true);
+    ASSERT_EQUAL(usage.postings >= 3000 * sizeof(pair<int, double>), true);
+    ASSERT_EQUAL(usage.document_ids >= 1000 * sizeof(int), true);
+    ASSERT_EQUAL(usage.stop_words, empty_usage.stop_words);
+    ASSERT_EQUAL_HINT(usage.caches >= 1000 * (sizeof(double) + 1), true,
+            "Накопитель релевантности потока должен учитываться в кэшах."s);
+    ASSERT_EQUAL(usage.GetTotal(),
+            usage.term_dictionary + usage.postings + usage.document_properties
+                    + usage.document_ids + usage.stop_words + usage.caches);
+
+    server.Compact();
+    const MemoryUsage compacted = server.GetMemoryUsage();
+    ASSERT_EQUAL_HINT(compacted.postings < usage.postings, true,
+            "Сжатие должно освобождать запас ёмкости списков документов."s);
+    ASSERT_EQUAL(compacted.document_ids, 1000 * sizeof(int));
+    ASSERT_EQUAL(compacted.GetTotal() < usage.GetTotal(), true);
+
+    const auto after = server.FindTopDocuments("хвост кот5 пёс7"s);
+    ASSERT_EQUAL(after.size(), before.size());
+    for (size_t i = 0; i < after.size(); ++i) {
+        ASSERT_EQUAL(after[i].id, before[i].id);
+    }
+}
+
+void TestDocumentReordering() {
+    SearchServer server("и в на"s);
+    const vector<string> topics = { "кот ошейник хвост"s, "пёс будка кость"s,
+            "скворец гнездо ветка"s, "рыба аквариум корм"s };
+    for (int i = 0; i < 400; ++i) {
+        server.AddDocument(1000 - i * 2,
+                topics[i % topics.size()] + " слово"s + to_string(i % 7),
+                i % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                { i % 9 });
+    }
+    const vector<string> queries = { "кот кость"s, "гнездо -ветка"s,
+            "аквариум слово3"s, "хвост* будка слово1"s };
+    vector<vector<Document>> before;
+    for (const string &query : queries) {
+        before.push_back(server.FindTopDocuments(query));
+    }
+    const double gap_bits_before = server.GetAveragePostingGapBits();
+
+    server.ReorderDocuments();
+    ASSERT_EQUAL_HINT(server.GetAveragePostingGapBits() < gap_bits_before,
+            true, "Перенумерация должна сокращать разности в списках."s);
+    for (int i = 0; i < server.GetDocumentCount(); ++i) {
+        ASSERT_EQUAL_HINT(server.GetDocumentId(i), 1000 - i * 2,
+                "Порядок добавления документов не должен меняться."s);
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto after = server.FindTopDocuments(queries[i]);
+        ASSERT_EQUAL(after.size(), before[i].size());
+        for (size_t j = 0; j < after.size(); ++j) {
+            ASSERT_EQUAL_HINT(after[j].id, before[i][j].id,
+                    "Перенумерация не должна менять порядок равных документов."s);
+            ASSERT_EQUAL(abs(after[j].relevance - before[i][j].relevance)
+                    < EPSILON, true);
+            ASSERT_EQUAL(after[j].rating, before[i][j].rating);
+        }
+    }
+    const auto [words, status] = server.MatchDocument("кот ошейник пёс"s, 1000);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(status == DocumentStatus::BANNED, true);
+
+    server.AddDocument(5000, "кот пёс"s, DocumentStatus::ACTUAL, { 100 });
+    ASSERT_EQUAL(server.FindTopDocuments("кот пёс"s)[0].id, 5000);
+}
+
+void TestSegmentedIndex() {
+    SearchServer segmented("и в на"s);
+    SearchServer single("и в на"s);
+    segmented.SetSegmentBufferSize(8);
+    const vector<string> topics = { "кот ошейник хвост"s, "пёс будка кость"s,
+            "скворец гнездо ветка"s, "рыба аквариум корм"s };
+    const vector<string> queries = { "кот кость"s, "гнездо -ветка"s,
+            "аквариум слово3"s, "хвост* будка слово1"s, "слово* -кот"s };
+    for (int i = 0; i < 500; ++i) {
+        const string text = topics[i % topics.size()] + " слово"s
+                + to_string(i % 7) + (i % 11 == 0 ? " кот"s : ""s);
+        const vector<int> ratings = { i % 9 };
+        segmented.AddDocument(i, text, DocumentStatus::ACTUAL, ratings);
+        single.AddDocument(i, text, DocumentStatus::ACTUAL, ratings);
+        // запросы выполняются одновременно с фоновым слиянием
+        if (i % 50 == 49) {
+            ASSERT_EQUAL(segmented.FindTopDocuments("кот"s).size(),
+                    single.FindTopDocuments("кот"s).size());
+        }
+    }
+    segmented.WaitForMerges();
+    ASSERT_EQUAL_HINT(segmented.GetSegmentCount() > 1u, true,
+            "Маленький буфер должен создавать несколько сегментов."s);
+    ASSERT_EQUAL_HINT(segmented.GetSegmentCount() < 500u / 8u, true,
+            "Сегменты должны сливаться в фоне."s);
+
+    const auto check_same_results = [&]() {
+        for (const string &query : queries) {
+            const auto expected = single.FindTopDocuments(query);
+            const auto actual = segmented.FindTopDocuments(query);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t j = 0; j < actual.size(); ++j) {
+                ASSERT_EQUAL_HINT(actual[j].id, expected[j].id,
+                        "IDF должен считаться по всем сегментам."s);
+                ASSERT_EQUAL(abs(actual[j].relevance - expected[j].relevance)
+                        < EPSILON, true);
+            }
+        }
+        const auto [words, status] = segmented.MatchDocument(
+                "кот* хвост слово0 пёс"s, 77);
+        const auto [expected_words, expected_status] = single.MatchDocument(
+                "кот* хвост слово0 пёс"s, 77);
+        ASSERT_EQUAL(words == expected_words, true);
+        ASSERT_EQUAL(words.size(), 3u);
+    };
+    check_same_results();
+
+    segmented.Compact();
+    ASSERT_EQUAL_HINT(segmented.GetSegmentCount(), 1u,
+            "После сжатия индекс состоит из одного сегмента."s);
+    check_same_results();
+
+    segmented.ReorderDocuments();
+    single.ReorderDocuments();
+    check_same_results();
+
+    segmented.AddDocument(1000, "кот пёс"s, DocumentStatus::ACTUAL, { 100 });
+    ASSERT_EQUAL(segmented.FindTopDocuments("кот пёс"s)[0].id, 1000);
+
+    // копия разделяет сегменты, но документы добавляются независимо
+    SearchServer copy = segmented;
+    for (int i = 2000; i < 2020; ++i) {
+        copy.AddDocument(i, "енот"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    ASSERT_EQUAL(copy.GetDocumentCount(), segmented.GetDocumentCount() + 20);
+    ASSERT_EQUAL_HINT(segmented.FindTopDocuments("енот"s).empty(), true,
+            "Документы копии не должны попадать в исходный сервер."s);
+    SearchServer moved = move(copy);
+    ASSERT_EQUAL(moved.FindTopDocuments("енот"s).size(), 5u);
+    ASSERT_EQUAL(moved.FindTopDocuments("кот пёс"s)[0].id, 1000);
+    copy = segmented;
+    ASSERT_EQUAL(copy.GetDocumentCount(), segmented.GetDocumentCount());
+    ASSERT_EQUAL(copy.FindTopDocuments("кот пёс"s)[0].id, 1000);
+    moved.WaitForMerges();
+}
+
+void TestCursorPagination() {
+    SearchServer server("и в на"s);
+    for (int i = 0; i < 100; ++i) {
+        // у многих документов совпадают релевантность и рейтинг
+        server.AddDocument(i, "кот"s + (i % 3 == 0 ? " кот"s : " пёс"s)
+                + (i % 4 == 0 ? " хвост"s : ""s),
+                i % 10 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                { i % 5 });
+    }
+    const SearchPage all = server.FindTopDocumentsPage("кот хвост"s, 1000);
+    ASSERT_EQUAL(all.documents.size(), 90u);
+    ASSERT_EQUAL_HINT(all.next_cursor.empty(), true,
+            "После последней страницы курсора нет."s);
+    const auto first = server.FindTopDocuments("кот хвост"s);
+    for (size_t i = 0; i < first.size(); ++i) {
+        ASSERT_EQUAL(abs(all.documents[i].relevance - first[i].relevance)
+                < EPSILON, true);
+        ASSERT_EQUAL(all.documents[i].rating, first[i].rating);
+    }
+
+    vector<Document> paged;
+    string cursor;
+    int pages = 0;
+    do {
+        const SearchPage page = server.FindTopDocumentsPage("кот хвост"s, 7,
+                cursor);
+        ASSERT_EQUAL_HINT(page.documents.size() <= 7u, true,
+                "Страница не должна превышать заданный размер."s);
+        paged.insert(paged.end(), page.documents.begin(),
+                page.documents.end());
+        cursor = page.next_cursor;
+        ++pages;
+    } while (!cursor.empty());
+    ASSERT_EQUAL(pages, 13);
+    ASSERT_EQUAL(paged.size(), all.documents.size());
+    for (size_t i = 0; i < paged.size(); ++i) {
+        ASSERT_EQUAL_HINT(paged[i].id, all.documents[i].id,
+                "Страницы должны продолжать друг друга без пропусков и повторов."s);
+    }
+
+    const SearchPage banned = server.FindTopDocumentsPage("кот"s,
+            [](int, DocumentStatus status, int) {
+                return status == DocumentStatus::BANNED;
+            }, 4);
+    ASSERT_EQUAL(banned.documents.size(), 4u);
+    ASSERT_EQUAL(banned.next_cursor.empty(), false);
+
+    bool thrown = false;
+    try {
+        server.FindTopDocumentsPage("кот"s, 5, "не курсор"s);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true, "Некорректный курсор должен отклоняться."s);
+
+    const string stale = server.FindTopDocumentsPage("кот"s, 5).next_cursor;
+    server.AddDocument(100, "кот"s, DocumentStatus::ACTUAL, { 1 });
+    thrown = false;
+    try {
+        server.FindTopDocumentsPage("кот"s, 5, stale);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Курсор устаревает после изменения индекса."s);
+
+    ASSERT_EQUAL(server.FindTopDocumentsPage("кот"s, MAX_PAGE_SIZE)
+            .next_cursor.empty(), true);
+    thrown = false;
+    try {
+        server.FindTopDocumentsPage("кот"s, size_t(1) << 40);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Слишком большой размер страницы должен отклоняться."s);
+
+    // соседние релевантности отличаются меньше чем на EPSILON, крайние — больше
+    using Ordering = CursorOrdering<TfIdfRanking>;
+    const vector<Document> near = { { 1, 1., 5 }, { 2, 1. + 0.6e-6, 3 }, {
+            3, 1. + 1.2e-6, 1 } };
+    for (const Document &a : near) {
+        const SearchCursor cursor { 0, Ordering::GetRelevanceKey(a.relevance),
+                a.rating, a.id };
+        for (const Document &b : near) {
+            ASSERT_EQUAL(Ordering::IsAfter(b, cursor),
+                    Ordering::IsBetter(a, b));
+            for (const Document &c : near) {
+                if (Ordering::IsBetter(a, b) && Ordering::IsBetter(b, c)) {
+                    ASSERT_EQUAL_HINT(Ordering::IsBetter(a, c), true,
+                            "Порядок постраничной выдачи должен быть транзитивным."s);
+                }
+            }
+        }
+    }
+}
+
+void TestProcessQueries() {
+    SearchServer server("и в на"s);
+    const vector<string> words = { "кот"s, "пёс"s, "хвост"s, "ошейник"s,
+            "скворец"s, "кошка"s, "котёнок"s };
+    for (int i = 0; i < 200; ++i) {
+        string text;
+        for (size_t j = 0; j < words.size(); ++j) {
+            if ((i + j) % (j + 2) == 0) {
+                text += words[j] + " "s;
+            }
+        }
+        server.AddDocument(i, text + "слово"s + to_string(i % 13),
+                i % 6 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                { i % 7 });
+    }
+    vector<string> queries;
+    for (int i = 0; i < 40; ++i) {
+        queries.push_back(words[i % words.size()] + " кот "s
+                + (i % 3 == 0 ? "-"s : ""s) + words[(i + 2) % words.size()]
+                + (i % 5 == 0 ? " кот*"s : ""s));
+    }
+    queries.push_back("-кот"s);
+    queries.push_back("неизвестное"s);
+
+    const auto check_batch = [&](const auto &batch, auto find) {
+        ASSERT_EQUAL(batch.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const vector<Document> expected = find(queries[i]);
+            ASSERT_EQUAL(batch[i].size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL_HINT(batch[i][j].id, expected[j].id,
+                        "Пакетный поиск должен совпадать с одиночным."s);
+                ASSERT_EQUAL(abs(batch[i][j].relevance - expected[j].relevance)
+                        < EPSILON, true);
+            }
+        }
+    };
+    check_batch(ProcessQueries(server, queries), [&](const string &query) {
+        return server.FindTopDocuments(query);
+    });
+    const size_t caches_before = server.GetMemoryUsage().caches;
+    const auto banned_batch = server.FindTopDocumentsBatch<Bm25Ranking>(
+            queries, DocumentStatus::BANNED);
+    ASSERT_EQUAL_HINT(server.GetMemoryUsage().caches, caches_before,
+            "Накопители пакета не должны оставаться после вызова."s);
+    check_batch(banned_batch, [&](const string &query) {
+        return server.FindTopDocuments<Bm25Ranking>(query,
+                DocumentStatus::BANNED);
+    });
+
+    // статус и фильтр для каждого запроса
+    vector<DocumentStatus> statuses;
+    vector<function<bool(int, DocumentStatus, int)>> filters;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        statuses.push_back(i % 2 == 0 ? DocumentStatus::ACTUAL
+                : DocumentStatus::BANNED);
+        const int divisor = static_cast<int>(i % 4) + 1;
+        filters.push_back([divisor](int id, DocumentStatus, int rating) {
+            return id % divisor == 0 && rating > 1;
+        });
+    }
+    const auto by_status = server.FindTopDocumentsBatch(queries, statuses);
+    const auto by_filter = server.FindTopDocumentsBatch(queries, filters);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected_by_status = server.FindTopDocuments(queries[i],
+                statuses[i]);
+        const auto expected_by_filter = server.FindTopDocuments(queries[i],
+                filters[i]);
+        ASSERT_EQUAL(by_status[i].size(), expected_by_status.size());
+        for (size_t j = 0; j < expected_by_status.size(); ++j) {
+            ASSERT_EQUAL_HINT(by_status[i][j].id, expected_by_status[j].id,
+                    "Статус должен применяться к своему запросу пакета."s);
+        }
+        ASSERT_EQUAL(by_filter[i].size(), expected_by_filter.size());
+        for (size_t j = 0; j < expected_by_filter.size(); ++j) {
+            ASSERT_EQUAL_HINT(by_filter[i][j].id, expected_by_filter[j].id,
+                    "Фильтр должен применяться к своему запросу пакета."s);
+        }
+    }
+    bool size_mismatch = false;
+    try {
+        server.FindTopDocumentsBatch(queries, vector<DocumentStatus>(2));
+    } catch (const invalid_argument&) {
+        size_mismatch = true;
+    }
+    ASSERT_EQUAL(size_mismatch, true);
+
+    size_t total = 0;
+    for (const string &query : queries) {
+        total += server.FindTopDocuments(query).size();
+    }
+    ASSERT_EQUAL(ProcessQueriesJoined(server, queries).size(), total);
+
+    bool thrown = false;
+    try {
+        ProcessQueries(server, { "кот"s, "кот --пёс"s });
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Ошибка в запросе пакета должна передаваться вызывающему."s);
+}
+
+void TestJournalRecovery() {
+    const filesystem::path directory = filesystem::temp_directory_path();
+    const string journal_path = (directory / "search_engine_test.journal").string();
+    const string snapshot_path = (directory / "search_engine_test.snapshot").string();
+    filesystem::remove(journal_path);
+    filesystem::remove(snapshot_path);
+
+    const vector<string> queries = { "кот пёс"s, "пушистый -хвост"s,
+            "ошейник* слово3"s };
+    SearchServer original("и в на"s);
+    {
+        JournalOptions options;
+        options.fsync_policy = FsyncPolicy::INTERVAL;
+        options.group_commit_bytes = 256;
+        Journal journal(journal_path, options);
+        const vector<string> texts = { "белый кот и модный ошейник"s,
+                "пушистый кот пушистый хвост"s, "ухоженный пёс выразительные глаза"s,
+                "ошейники для пёс и кот"s };
+        for (int i = 0; i < 60; ++i) {
+            const string text = texts[i % texts.size()] + " слово"s
+                    + to_string(i % 5);
+            const TokenizedDocument document = original.TokenizeDocument(i,
+                    text, static_cast<DocumentStatus>(i % 3), { i % 4, -i });
+            ASSERT_EQUAL(journal.Append(document), static_cast<uint64_t>(i + 1));
+            original.AddDocument(document);
+            if (i == 39) {
+                Checkpoint(original, journal, snapshot_path);
+                ASSERT_EQUAL_HINT(filesystem::file_size(journal_path) < 64u,
+                        true, "После снимка журнал должен очищаться."s);
+            }
+        }
+        journal.Commit();
+        ASSERT_EQUAL(journal.GetCommittedLsn(), 60u);
+    }
+    // недописанная при сбое запись
+    {
+        ofstream out(journal_path, ios::binary | ios::app);
+        out << "\x20\x00\x00\x00\x01\x02"s;
+    }
+
+    SearchServer recovered("и в на"s);
+    ASSERT_EQUAL(RecoverSearchServer(recovered, snapshot_path, journal_path),
+            60u);
+    ASSERT_EQUAL(recovered.GetDocumentCount(), original.GetDocumentCount());
+    for (int i = 0; i < original.GetDocumentCount(); ++i) {
+        ASSERT_EQUAL(recovered.GetDocumentId(i), original.GetDocumentId(i));
+    }
+    for (const string &query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL,
+                DocumentStatus::IRRELEVANT, DocumentStatus::BANNED }) {
+            const auto expected = original.FindTopDocuments(query, status);
+            const auto actual = recovered.FindTopDocuments(query, status);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t j = 0; j < actual.size(); ++j) {
+                ASSERT_EQUAL_HINT(actual[j].id, expected[j].id,
+                        "Восстановленный индекс должен давать те же результаты."s);
+                ASSERT_EQUAL(actual[j].rating, expected[j].rating);
+                ASSERT_EQUAL(abs(actual[j].relevance - expected[j].relevance)
+                        < EPSILON, true);
+            }
+        }
+    }
+
+    {
+        Journal journal(journal_path);
+        ASSERT_EQUAL_HINT(journal.GetLastLsn(), 60u,
+                "Недописанная запись должна отбрасываться при открытии."s);
+        ASSERT_EQUAL(journal.Append(recovered.TokenizeDocument(100,
+                "новый кот"s, DocumentStatus::ACTUAL, { 5 })), 61u);
+    }
+    int replayed = 0;
+    ASSERT_EQUAL(Journal::Replay(journal_path, 60,
+            [&replayed](const TokenizedDocument &document) {
+                ASSERT_EQUAL(document.id, 100);
+                ASSERT_EQUAL(document.word_counts.size(), 2u);
+                ++replayed;
+            }), 61u);
+    ASSERT_EQUAL(replayed, 1);
+
+    bool thrown = false;
+    try {
+        SearchServer other_stop_words("и"s);
+        LoadSnapshot(other_stop_words, snapshot_path);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Снимок нельзя загрузить в сервер с другими стоп-словами."s);
+    filesystem::remove(journal_path);
+    filesystem::remove(snapshot_path);
+}
+
+void TestJournalRejectedDocuments() {
+    const filesystem::path directory = filesystem::temp_directory_path();
+    const string journal_path =
+            (directory / "search_engine_rejected.journal").string();
+    filesystem::remove(journal_path);
+
+    SearchServer original("и в на"s);
+    {
+        Journal journal(journal_path);
+        for (const string &text : { "белый кот"s, "пушистый пёс"s }) {
+            const TokenizedDocument document = original.TokenizeDocument(1,
+                    text, DocumentStatus::ACTUAL, { 1 });
+            try {
+                original.CheckDocument(document);
+            } catch (const invalid_argument&) {
+                continue;
+            }
+            journal.Append(document);
+            original.AddDocument(document);
+        }
+        ASSERT_EQUAL_HINT(journal.GetLastLsn(), 1u,
+                "Отклонённый документ не должен попадать в журнал."s);
+        // запись, добавленная в журнал в обход проверки
+        journal.Append(original.TokenizeDocument(1, "рыжий кот"s,
+                DocumentStatus::ACTUAL, { 2 }));
+        journal.Append(original.TokenizeDocument(2, "рыжий кот"s,
+                DocumentStatus::ACTUAL, { 3 }));
+    }
+
+    SearchServer recovered("и в на"s);
+    ASSERT_EQUAL(RecoverSearchServer(recovered,
+            (directory / "search_engine_rejected.snapshot").string(),
+            journal_path), 3u);
+    ASSERT_EQUAL_HINT(recovered.GetDocumentCount(), 2,
+            "Восстановление должно пропускать отклоняемые записи."s);
+    const auto documents = recovered.FindTopDocuments("белый рыжий"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(recovered.FindTopDocuments("пушистый"s).empty(), true);
+    filesystem::remove(journal_path);
+}
+
+void TestJournalWriteFailure() {
+    const string journal_path = (filesystem::temp_directory_path()
+            / "search_engine_failure.journal").string();
+    filesystem::remove(journal_path);
+    SearchServer server("и в на"s);
+    const auto tokenize = [&server](int id, const string &text) {
+        return server.TokenizeDocument(id, text, DocumentStatus::ACTUAL,
+                { 1 });
+    };
+    {
+        JournalOptions options;
+        options.fsync_policy = FsyncPolicy::NEVER;
+        Journal journal(journal_path, options);
+        journal.Append(tokenize(1, "белый кот"s));
+        journal.Commit();
+        const auto good_size = filesystem::file_size(journal_path);
+
+        // ограничение размера файла: запись обрывается на середине
+        signal(SIGXFSZ, SIG_IGN);
+        rlimit old_limit;
+        getrlimit(RLIMIT_FSIZE, &old_limit);
+        rlimit limit = old_limit;
+        limit.rlim_cur = good_size + 16;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        journal.Append(
+                tokenize(2, "пушистый рыжий котёнок с длинным хвостом"s));
+        bool thrown = false;
+        try {
+            journal.Commit();
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        setrlimit(RLIMIT_FSIZE, &old_limit);
+        signal(SIGXFSZ, SIG_DFL);
+        ASSERT_EQUAL_HINT(thrown, true, "Ошибка записи должна передаваться."s);
+        ASSERT_EQUAL_HINT(filesystem::file_size(journal_path), good_size,
+                "Недописанная запись должна отрезаться."s);
+
+        thrown = false;
+        try {
+            journal.Append(tokenize(3, "рыжий котёнок"s));
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        ASSERT_EQUAL_HINT(thrown, true,
+                "После ошибки записи журнал не принимает записи."s);
+    }
+    {
+        Journal journal(journal_path);
+        ASSERT_EQUAL(journal.GetLastLsn(), 1u);
+        ASSERT_EQUAL(journal.Append(tokenize(3, "рыжий котёнок"s)), 2u);
+    }
+
+    // целая запись со ссылкой на неизвестное слово завершает журнал
+    {
+        string payload;
+        payload.push_back(static_cast<char>(Journal::RecordType::ADD_DOCUMENT));
+        WriteVarint(payload, 3);
+        WriteSignedVarint(payload, 4);
+        WriteVarint(payload, 0);
+        WriteVarint(payload, 0);
+        WriteVarint(payload, 1);
+        WriteVarint(payload, 0);
+        WriteVarint(payload, 1);
+        WriteVarint(payload, 999);
+        WriteVarint(payload, 1);
+        string frame;
+        WriteFixed32(frame, payload.size());
+        WriteFixed32(frame, ComputeCrc32(payload));
+        ofstream out(journal_path, ios::binary | ios::app);
+        out << frame << payload;
+    }
+    SearchServer recovered("и в на"s);
+    ASSERT_EQUAL(RecoverSearchServer(recovered,
+            journal_path + ".snapshot"s, journal_path), 2u);
+    ASSERT_EQUAL(recovered.GetDocumentCount(), 2);
+    ASSERT_EQUAL(recovered.GetDocumentId(1), 3);
+    {
+        Journal journal(journal_path);
+        ASSERT_EQUAL(journal.GetLastLsn(), 2u);
+    }
+    filesystem::remove(journal_path);
+}
+
+void TestSnapshotStopWordDocument() {
+    const string snapshot_path = (filesystem::temp_directory_path()
+            / "search_engine_stop_words.snapshot").string();
+    SearchServer original("и в на"s);
+    original.AddDocument(1, "белый кот"s, DocumentStatus::ACTUAL, { 4 });
+    original.AddDocument(2, "и в на"s, DocumentStatus::ACTUAL, { 1 });
+    SaveSnapshot(original, snapshot_path, 2);
+
+    SearchServer loaded("и в на"s);
+    ASSERT_EQUAL(LoadSnapshot(loaded, snapshot_path), 2u);
+    ASSERT_EQUAL_HINT(loaded.GetDocumentCount(), 2,
+            "Документ только из стоп-слов должен восстанавливаться."s);
+    ASSERT_EQUAL(loaded.GetDocumentId(1), 2);
+    const auto expected = original.FindTopDocuments("белый кот"s);
+    const auto actual = loaded.FindTopDocuments("белый кот"s);
+    ASSERT_EQUAL(actual.size(), 1u);
+    ASSERT_EQUAL(expected.size(), 1u);
+    ASSERT_EQUAL(abs(actual[0].relevance - expected[0].relevance) < EPSILON,
+            true);
+    filesystem::remove(snapshot_path);
+}
+
+void TestFirstTierPruning() {
+    SearchServer server("и в на"s);
+    server.SetSegmentBufferSize(64);
+    server.SetFirstTierSize(20);
+    for (int i = 0; i < 400; ++i) {
+        string text;
+        if (i % 40 == 0) {
+            text = "кот кот кот кот хвост"s;
+        } else if (i % 2 == 0) {
+            text = "кот пёс слово"s + to_string(i % 9) + " корм ошейник"s;
+        } else {
+            text = "пёс будка слово"s + to_string(i % 7);
+        }
+        server.AddDocument(i, text,
+                i % 80 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+                { i % 10 });
+    }
+    server.Compact();
+
+    const auto check_same = [](const vector<Document> &actual,
+            const vector<Document> &expected) {
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL_HINT(abs(actual[i].relevance - expected[i].relevance)
+                    < EPSILON, true,
+                    "Поиск по первому уровню должен совпадать с точным."s);
+            ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+        }
+    };
+
+    check_same(server.FindTopDocuments("кот"s),
+            server.FindTopDocumentsExact("кот"s));
+    FirstTierStats stats = server.GetFirstTierStats();
+    ASSERT_EQUAL(stats.queries, 1u);
+    ASSERT_EQUAL_HINT(stats.fallbacks, 0u,
+            "Документы с высокой частотой слова доказывают полноту результата."s);
+
+    // фильтр отбрасывает все документы с высокой частотой слова
+    const auto without_frequent = [](int document_id, DocumentStatus, int) {
+        return document_id % 40 != 0;
+    };
+    check_same(server.FindTopDocuments("кот"s, without_frequent),
+            server.FindTopDocumentsExact("кот"s, without_frequent));
+    stats = server.GetFirstTierStats();
+    ASSERT_EQUAL(stats.queries, 2u);
+    ASSERT_EQUAL_HINT(stats.fallbacks, 1u,
+            "Без доказательства полноты поиск выполняется по полным спискам."s);
+
+    for (const string &query : { "кот -хвост"s, "кот пёс будка"s,
+            "ко* -слово1"s, "хвост корм"s }) {
+        check_same(server.FindTopDocuments(query),
+                server.FindTopDocumentsExact(query));
+        check_same(server.FindTopDocuments(query, DocumentStatus::BANNED),
+                server.FindTopDocumentsExact(query, DocumentStatus::BANNED));
+        check_same(server.FindTopDocuments<Bm25Ranking>(query),
+                server.FindTopDocumentsExact<Bm25Ranking>(query,
+                        [](int, DocumentStatus status, int) {
+                            return status == DocumentStatus::ACTUAL;
+                        }));
+    }
+
+    server.SetFirstTierSize(0);
+    server.Compact();
+    const size_t queries = server.GetFirstTierStats().queries;
+    server.FindTopDocuments("кот"s);
+    ASSERT_EQUAL_HINT(server.GetFirstTierStats().queries, queries,
+            "Выключенный первый уровень не используется."s);
+}
+
+void TestAdmissionControl() {
+    SearchServer server("и в на"s);
+    for (int i = 0; i < 200; ++i) {
+        server.AddDocument(i, "кот пёс слово"s + to_string(i % 10)
+                + (i % 50 == 0 ? " скворец"s : ""s), DocumentStatus::ACTUAL,
+                { i % 7 });
+    }
+    ASSERT_EQUAL(server.EstimateQueryCost("кот -скворец"s), 204u);
+    {
+        SearchServer segmented("и в на"s);
+        segmented.SetSegmentBufferSize(8);
+        for (int i = 0; i < 100; ++i) {
+            segmented.AddDocument(i, (i % 4 == 0 ? "кошка"s : "кот"s)
+                    + " пёс"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        ASSERT_EQUAL(segmented.GetSegmentCount() > 1u, true);
+        ASSERT_EQUAL_HINT(segmented.EstimateQueryCost("ко* кот -пёс -пёс"s),
+                200u, "Слова из разных сегментов и повторы считаются один раз."s);
+    }
+    const string expensive = "кот пёс"s;
+    const string cheap = "скворец"s;
+
+    {
+        AdmissionOptions options;
+        options.max_concurrency = 2;
+        options.target_queue_delay = chrono::seconds(10);
+        RequestQueue queue(server, options);
+        vector<future<ScheduledResult>> results;
+        for (int i = 0; i < 20; ++i) {
+            results.push_back(queue.SubmitFindRequest("слово"s + to_string(i)));
+        }
+        for (int i = 0; i < 20; ++i) {
+            const ScheduledResult result = results[i].get();
+            ASSERT_EQUAL(result.outcome == RequestOutcome::COMPLETED, true);
+            ASSERT_EQUAL(result.documents.size(),
+                    server.FindTopDocuments("слово"s + to_string(i)).size());
+        }
+        queue.Wait();
+        ASSERT_EQUAL(queue.GetRequestCount(), 20);
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 10);
+        ASSERT_EQUAL(queue.GetQueueDelayHistogram().GetCount(), 20u);
+
+        bool thrown = false;
+        try {
+            queue.SubmitFindRequest("кот --пёс"s);
+        } catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_EQUAL_HINT(thrown, true,
+                "Некорректный запрос отклоняется при постановке в очередь."s);
+    }
+
+    {
+        AdmissionOptions options;
+        options.max_concurrency = 1;
+        options.max_pending = 2;
+        options.target_queue_delay = chrono::seconds(10);
+        RequestQueue queue(server, options);
+        // первый запрос занимает единственный поток, пока не открыт gate
+        promise<void> gate;
+        shared_future<void> opened = gate.get_future().share();
+        promise<void> started;
+        bool started_set = false;
+        auto blocker = queue.SubmitFindRequest(cheap,
+                [&](int, DocumentStatus, int) {
+                    if (!started_set) {
+                        started_set = true;
+                        started.set_value();
+                    }
+                    opened.wait();
+                    return true;
+                }, RequestPriority::HIGH);
+        started.get_future().wait();
+
+        auto low_cheap = queue.SubmitFindRequest(cheap, RequestPriority::LOW);
+        auto low_expensive = queue.SubmitFindRequest(expensive,
+                RequestPriority::LOW);
+        // очередь заполнена: вытесняется самый дорогой запрос LOW
+        auto normal = queue.SubmitFindRequest(expensive);
+        // новый запрос LOW не дороже ожидающих и отклоняется сам
+        auto low_rejected = queue.SubmitFindRequest(cheap,
+                RequestPriority::LOW);
+        ASSERT_EQUAL(low_expensive.get().outcome == RequestOutcome::REJECTED,
+                true);
+        ASSERT_EQUAL(low_rejected.get().outcome == RequestOutcome::REJECTED,
+                true);
+        gate.set_value();
+        ASSERT_EQUAL(blocker.get().outcome == RequestOutcome::COMPLETED, true);
+        ASSERT_EQUAL(low_cheap.get().outcome == RequestOutcome::COMPLETED,
+                true);
+        ASSERT_EQUAL(normal.get().documents.size(), 5u);
+        queue.Wait();
+        ASSERT_EQUAL(queue.GetRejectedRequests(), 2);
+        ASSERT_EQUAL(queue.GetRequestCount(), 3);
+    }
+
+    {
+        AdmissionOptions options;
+        options.max_concurrency = 1;
+        // любое ожидание в очереди считается перегрузкой
+        options.target_queue_delay = chrono::microseconds(0);
+        options.expensive_cost = 100;
+        options.degraded_budget = chrono::microseconds(0);
+        RequestQueue queue(server, options);
+        const ScheduledResult shed = queue.SubmitFindRequest(expensive,
+                RequestPriority::LOW).get();
+        ASSERT_EQUAL_HINT(shed.outcome == RequestOutcome::REJECTED, true,
+                "При перегрузке дорогой запрос LOW сбрасывается."s);
+        const ScheduledResult degraded = queue.SubmitFindRequest(expensive,
+                RequestPriority::NORMAL).get();
+        ASSERT_EQUAL_HINT(degraded.outcome == RequestOutcome::DEGRADED, true,
+                "При перегрузке запрос NORMAL выполняется с ограничением времени."s);
+        const ScheduledResult high = queue.SubmitFindRequest(expensive,
+                RequestPriority::HIGH).get();
+        ASSERT_EQUAL(high.outcome == RequestOutcome::COMPLETED, true);
+        ASSERT_EQUAL(high.documents.size(), 5u);
+        for (const RequestPriority priority : { RequestPriority::NORMAL,
+                RequestPriority::LOW }) {
+            const ScheduledResult cheap_result = queue.SubmitFindRequest(cheap,
+                    priority).get();
+            ASSERT_EQUAL_HINT(
+                    cheap_result.outcome == RequestOutcome::COMPLETED, true,
+                    "Дешёвый запрос выполняется полностью и при перегрузке."s);
+            ASSERT_EQUAL(cheap_result.documents.size(), 4u);
+        }
+        queue.Wait();
+        ASSERT_EQUAL(queue.GetRejectedRequests(), 1);
+        ASSERT_EQUAL(queue.GetDegradedRequests(), 1);
+    }
+
+    {
+        AdmissionOptions options;
+        options.max_concurrency = 2;
+        options.target_queue_delay = chrono::seconds(10);
+        RequestQueue queue(server, options, true);
+        for (int i = 0; i < 10; ++i) {
+            queue.AddFindRequest(expensive);
+        }
+        for (int i = 0; i < 30; ++i) {
+            queue.SubmitFindRequest(expensive);
+        }
+        queue.Wait();
+        ASSERT_EQUAL(queue.GetLatencyHistogram().GetCount(), 40u);
+        for (const QueryStage stage : { QueryStage::PARSE, QueryStage::SCORE,
+                QueryStage::RANK }) {
+            const LatencyHistogram &histogram = queue.GetLatencyHistogram(stage);
+            ASSERT_EQUAL(histogram.GetCount(), 40u);
+            ASSERT_EQUAL_HINT(
+                    histogram.GetPercentile(1) > chrono::nanoseconds(10), true,
+                    "Запланированные запросы должны передавать время этапов."s);
+        }
+    }
+}
+
 /*
  Разместите код остальных тестов здесь
  */
 
+void TestStopWordFilter() {
+    // проверка на этапе компиляции
+    constexpr StaticStopWordFilter static_filter(
+            std::array<string_view, 4> { "и"sv, "в"sv, "на"sv, "под"sv });
+    static_assert(static_filter.GetSize() == 4);
+    static_assert(static_filter.Contains("на"sv));
+    static_assert(static_filter.Contains("под"sv));
+    static_assert(!static_filter.Contains("над"sv));
+    static_assert(!static_filter.Contains(""sv));
+
+    // сервер копирует таблицу, построенную компилятором
+    SearchServer static_server(static_filter);
+    ASSERT_EQUAL(static_server.GetStopWords()
+            == vector<string>({ "в"s, "и"s, "на"s, "под"s }), true);
+    static_server.AddDocument(1, "кот под столом"s, DocumentStatus::ACTUAL,
+            { 1 });
+    ASSERT_EQUAL_HINT(static_server.FindTopDocuments("под"s).empty(), true,
+            "Стоп-слова из таблицы компиляции не должны попадать в индекс."s);
+    ASSERT_EQUAL(static_server.FindTopDocuments("под кот"s).size(), 1u);
+    const SearchServer no_stop_words(
+            StaticStopWordFilter(std::array<string_view, 0> { }));
+    ASSERT_EQUAL(no_stop_words.GetStopWords().empty(), true);
+
+    // совпадение хешей различных слов исправляется сменой затравки
+    const uint64_t same_hashes[] = { 7, 7 };
+    uint32_t displacements[2] = { };
+    int slot_keys[2] = { };
+    size_t bucket_keys[2] = { };
+    size_t bucket_starts[3] = { };
+    size_t bucket_order[2] = { };
+    ASSERT_EQUAL(perfect_hash::AssignSlots(same_hashes, 2, displacements, 2,
+            slot_keys, bucket_keys, bucket_starts, bucket_order), false);
+    ASSERT_EQUAL(perfect_hash::HashBytes("кот"sv, 1)
+            != perfect_hash::HashBytes("кот"sv, 0), true);
+
+    const StopWordFilter empty_filter;
+    ASSERT_EQUAL(empty_filter.Contains("и"s), false);
+    ASSERT_EQUAL(empty_filter.Contains(""s), false);
+    ASSERT_EQUAL(StopWordFilter(vector<string> { ""s, ""s }).GetSize(), 0u);
+
+    vector<string> words;
+    for (int i = 0; i < 5000; ++i) {
+        words.push_back("w"s + to_string(i));
+    }
+    // повторы и пустые слова не должны мешать построению
+    words.push_back("w17"s);
+    words.push_back(""s);
+    const StopWordFilter filter(words);
+    ASSERT_EQUAL(filter.GetSize(), 5000u);
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_EQUAL_HINT(filter.Contains("w"s + to_string(i)), true,
+                "Каждое стоп-слово должно находиться в фильтре."s);
+        // та же длина и тот же первый байт проходят предварительный отсев
+        ASSERT_EQUAL_HINT(filter.Contains("x"s + to_string(i)), false,
+                "Слово не из набора не должно находиться в фильтре."s);
+        ASSERT_EQUAL(filter.Contains("w"s + to_string(i + 5000)), false);
+    }
+    ASSERT_EQUAL(filter.Contains(""s), false);
+    const vector<string> sorted_words = filter.GetWords();
+    ASSERT_EQUAL(is_sorted(sorted_words.begin(), sorted_words.end()), true);
+    ASSERT_EQUAL(sorted_words.size(), 5000u);
+
+    SearchServer server(vector<string> { "и"s, "в"s, "и"s, "на"s });
+    ASSERT_EQUAL(server.GetStopWords() == vector<string>({ "в"s, "и"s, "на"s }),
+            true);
+    server.AddDocument(1, "кот и пёс  в доме"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("и"s).empty(), true,
+            "Стоп-слова не должны попадать в индекс."s);
+    ASSERT_EQUAL(server.FindTopDocuments("и кот"s).size(), 1u);
+    const auto [matched, status] = server.MatchDocument("в доме и пёс"s, 1);
+    ASSERT_EQUAL(matched.size(), 2u);
+    bool thrown = false;
+    try {
+        server.FindTopDocuments("кот \x01"s);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_EQUAL_HINT(thrown, true,
+            "Запрос с запрещенными символами должен отклоняться."s);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
     RUN_TEST(TestExcludeMinusWordsFromAddedDocumentContent);
@@ -269,5 +1524,23 @@ void TestSearchServer() {
     RUN_TEST(TestMatchedMinusWordsDoNotResetPlusWords1);
     RUN_TEST(TestQueue);
     RUN_TEST(TestPage);
+    RUN_TEST(TestQueryStats);
+    RUN_TEST(TestAsyncSearch);
+    RUN_TEST(TestCorpusIngestion);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestRankingPolicy);
+    RUN_TEST(TestLoadGenerator);
+    RUN_TEST(TestMemoryUsage);
+    RUN_TEST(TestDocumentReordering);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestCursorPagination);
+    RUN_TEST(TestProcessQueries);
+    RUN_TEST(TestJournalRecovery);
+    RUN_TEST(TestJournalRejectedDocuments);
+    RUN_TEST(TestSnapshotStopWordDocument);
+    RUN_TEST(TestJournalWriteFailure);
+    RUN_TEST(TestFirstTierPruning);
+    RUN_TEST(TestAdmissionControl);
+    RUN_TEST(TestStopWordFilter);
 }
 
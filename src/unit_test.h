@@ -49,6 +49,42 @@ void TestFilterUserPredicateDoc();
 void TestPage();
 // Тестирование очереди запросов
 void TestQueue();
+// Статистика выполнения запросов и гистограммы задержек в очереди запросов
+void TestQueryStats();
+// Асинхронный поиск со сроком выполнения и отменой
+void TestAsyncSearch();
+// Загрузка корпуса документов из файла
+void TestCorpusIngestion();
+// Словарь слов индекса и поиск по префиксу слова
+void TestTermDictionary();
+// Политики ранжирования TF-IDF и BM25
+void TestRankingPolicy();
+// Воспроизведение журнала запросов в нескольких потоках
+void TestLoadGenerator();
+// Подсчёт занятой индексом памяти и её освобождение
+void TestMemoryUsage();
+// Перенумерация документов для улучшения локальности списков документов
+void TestDocumentReordering();
+// Индекс из сегментов с фоновым слиянием
+void TestSegmentedIndex();
+// Постраничный поиск с курсором
+void TestCursorPagination();
+// Пакетная обработка запросов с общими словами
+void TestProcessQueries();
+// Журнал добавления документов, снимок индекса и восстановление после сбоя
+void TestJournalRecovery();
+// Документы, отклонённые сервером, не мешают восстановлению
+void TestJournalRejectedDocuments();
+// Снимок с документом только из стоп-слов сохраняется и загружается
+void TestSnapshotStopWordDocument();
+// Ошибка записи в журнал не повреждает его
+void TestJournalWriteFailure();
+// Поиск по первому уровню индекса с переходом к полным спискам
+void TestFirstTierPruning();
+// Планировщик очереди запросов: приоритеты, ограничение очереди и сброс нагрузки
+void TestAdmissionControl();
+// Фильтр стоп-слов на минимальной совершенной хеш-функции
+void TestStopWordFilter();
 
 /*
  Разместите код остальных тестов здесь